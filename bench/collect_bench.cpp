@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_file_cache.h"
+#include "proc_fixture.h"
+#include "proc_parser.h"
+#include "worker_pool.h"
+
+/*
+Scaling benchmark of the parallel /proc/[pid]/stat collection.
+A synthetic proc tree with the requested number of processes is
+collected with pools of 1, 2, 4, ... threads the same way
+System::Processes() does, so every stat file read is a distinct one.
+*/
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+  int pid;
+  ProcParser::Stat stat;
+};
+
+double CollectMilliseconds(WorkerPool& pool, const std::vector<int>& pids,
+                           int rounds) {
+  std::vector<std::vector<Sample>> samples(pool.Size());
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; ++round) {
+    for (auto& slice : samples) slice.clear();
+    pool.ParallelFor(pids.size(), 128,
+                     [&](std::size_t begin, std::size_t end,
+                         std::size_t worker) {
+                       auto& slice = samples[worker];
+                       for (std::size_t i = begin; i < end; ++i) {
+                         slice.push_back({pids[i], {}});
+                         if (!ProcParser::ReadStat(pids[i], slice.back().stat))
+                           slice.pop_back();
+                       }
+                     });
+  }
+  auto elapsed =
+      std::chrono::duration<double, std::milli>(Clock::now() - start);
+  return elapsed.count() / rounds;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // Size the descriptor cache the way the monitor does
+  ProcFileCache::RaiseDescriptorLimit();
+  std::size_t count = argc > 1 ? std::stoul(argv[1]) : 30000;
+  std::size_t maxThreads =
+      argc > 2 ? std::stoul(argv[2]) : 2 * std::thread::hardware_concurrency();
+  int rounds = 5;
+
+  char root[] = "/tmp/monitor-fixture-XXXXXX";
+  if (mkdtemp(root) == nullptr) return 1;
+  ProcFixture::Options options;
+  options.processes = count;
+  ProcFixture fixture(root, options);
+  if (!fixture.Create()) {
+    std::fprintf(stderr, "collect_bench: cannot create fixture in %s\n",
+                 root);
+    return 1;
+  }
+  LinuxParser::SetRoots(fixture.ProcDirectory(), fixture.EtcDirectory());
+  const std::vector<int>& pids = fixture.Pids();
+
+  std::printf("%zu pids, %d rounds\n", pids.size(), rounds);
+  double base = 0;
+  for (std::size_t threads = 1; threads <= std::max<std::size_t>(maxThreads, 1);
+       threads *= 2) {
+    WorkerPool pool(threads);
+    double ms = CollectMilliseconds(pool, pids, rounds);
+    if (threads == 1) base = ms;
+    std::printf("threads %3zu  %9.2f ms/refresh  speedup %5.2fx\n", threads,
+                ms, base / ms);
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_file_cache.h"
+
+/*
+Syscall counts and time of one refresh worth of proc reads (the global
+files plus /proc/[pid]/stat of every process), with descriptors reopened
+on every read versus kept open in the cache.
+*/
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+void Refresh(ProcFileCache& cache, const std::vector<int>& pids,
+             std::string& global) {
+  char buffer[4096];
+  cache.Read(ProcFileCache::Global::kStat, global);
+  cache.Read(ProcFileCache::Global::kMeminfo, global);
+  cache.Read(ProcFileCache::Global::kUptime, global);
+  for (int pid : pids) {
+    cache.Read(pid, ProcFileCache::PidFile::kStat, buffer, sizeof(buffer));
+  }
+}
+
+void Run(const char* name, ProcFileCache& cache, const std::vector<int>& pids,
+         int ticks) {
+  std::string global;
+  Refresh(cache, pids, global);  // warm up, opens the cached descriptors
+  auto before = cache.Count();
+  auto start = Clock::now();
+  for (int tick = 0; tick < ticks; ++tick) Refresh(cache, pids, global);
+  auto elapsed =
+      std::chrono::duration<double, std::micro>(Clock::now() - start);
+  auto after = cache.Count();
+  double opens = double(after.opens - before.opens) / ticks;
+  double reads = double(after.reads - before.reads) / ticks;
+  double closes = double(after.closes - before.closes) / ticks;
+  std::printf("%-9s open %8.1f  read %8.1f  close %8.1f  syscalls %8.1f"
+              "  %9.1f us/refresh\n",
+              name, opens, reads, closes, opens + reads + closes,
+              elapsed.count() / ticks);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // Size the descriptor cache the way the monitor does
+  ProcFileCache::RaiseDescriptorLimit();
+  int ticks = argc > 1 ? std::stoi(argv[1]) : 50;
+  std::vector<int> pids = LinuxParser::Pids();
+  std::printf("%zu pids, %d refreshes, per refresh:\n", pids.size(), ticks);
+
+  ProcFileCache uncached(1);
+  Run("reopen", uncached, pids, ticks);
+  ProcFileCache cached;
+  Run("cached", cached, pids, ticks);
+  std::printf("descriptor budget %zu\n", cached.Budget());
+  return 0;
+}
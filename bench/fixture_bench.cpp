@@ -0,0 +1,179 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "net_stats.h"
+#include "pid_enumerator.h"
+#include "proc_file_cache.h"
+#include "proc_fixture.h"
+#include "proc_parser.h"
+#include "system.h"
+#include "system_snapshot.h"
+#include "user_table.h"
+
+/*
+Collector benchmark on synthetic /proc trees of 1k, 10k and 100k
+processes (or the sizes given on the command line).
+Reports the full refresh latency of System, with processes exiting,
+starting and using CPU between refreshes, the heap footprint of its
+process table, and the per-call cost of the parsing functions it is built
+from. Each size runs in its own child
+process, since the parsers cache open files and tables for good.
+*/
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// Time fn over every pid for the given rounds and print the cost per call
+template <typename Fn>
+void PerPid(const char* name, const std::vector<int>& pids, int rounds,
+            Fn fn) {
+  std::size_t sink = 0;
+  for (int pid : pids) sink += fn(pid);  // warm up caches
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; ++round) {
+    for (int pid : pids) sink += fn(pid);
+  }
+  double us = Microseconds(Clock::now() - start);
+  std::printf("  %-28s %9.3f us/call   (%zu)\n", name,
+              us / rounds / std::max<std::size_t>(pids.size(), 1), sink % 10);
+}
+
+template <typename Fn>
+void PerTick(const char* name, int rounds, Fn fn) {
+  std::size_t sink = fn();
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; ++round) sink += fn();
+  std::printf("  %-28s %9.3f ms/call   (%zu)\n", name,
+              Microseconds(Clock::now() - start) / 1000 / rounds, sink % 10);
+}
+
+int Run(std::size_t processes, int rounds) {
+  char root[] = "/tmp/monitor-fixture-XXXXXX";
+  if (mkdtemp(root) == nullptr) return 1;
+  ProcFixture::Options options;
+  options.processes = processes;
+  ProcFixture fixture(root, options);
+  auto start = Clock::now();
+  if (!fixture.Create()) {
+    std::fprintf(stderr, "fixture_bench: cannot create fixture in %s\n",
+                 root);
+    return 1;
+  }
+  std::printf("%zu processes (fixture built in %.0f ms)\n", processes,
+              Microseconds(Clock::now() - start) / 1000);
+  LinuxParser::SetRoots(fixture.ProcDirectory(), fixture.EtcDirectory());
+
+  // Full refresh, the way the sampler drives it
+  {
+    System system(0, false);
+    start = Clock::now();
+    system.Refresh();
+    system.Processes(10);
+    double cold = Microseconds(Clock::now() - start) / 1000;
+    std::vector<double> times;
+    for (int round = 0; round < rounds; ++round) {
+      if (!fixture.Advance(processes / 10, processes / 100)) return 1;
+      start = Clock::now();
+      system.Refresh();
+      system.Processes(10);
+      times.push_back(Microseconds(Clock::now() - start) / 1000);
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double ms : times) total += ms;
+    std::printf(
+        "  refresh                  %9.3f ms cold, %.3f ms mean, %.3f ms "
+        "median, %.3f ms max\n",
+        cold, total / times.size(), times[times.size() / 2], times.back());
+    // Only displayed rows intern their strings; ranking every process
+    // loads them all
+    const ProcessTable& table = system.Table();
+    std::size_t tracked = std::max<std::size_t>(table.size(), 1);
+    double bytes = static_cast<double>(table.Bytes()) / tracked;
+    system.Refresh();
+    system.Processes();
+    std::printf(
+        "  process table            %9.1f bytes/process, %.1f with all "
+        "strings (%zu tracked)\n",
+        bytes, static_cast<double>(table.Bytes()) / tracked, table.size());
+  }
+
+  // The pieces a refresh is built from
+  const std::vector<int>& pids = fixture.Pids();
+  PidEnumerator enumerator;
+  std::vector<int> listed;
+  PerTick("PidEnumerator::Read", rounds, [&] {
+    enumerator.Read(listed);
+    return listed.size();
+  });
+  SystemSnapshot snapshot;
+  PerTick("SystemSnapshot::Read", rounds, [&] {
+    snapshot.Read();
+    return static_cast<std::size_t>(snapshot.forks);
+  });
+  // Nothing moves between rounds, so this is the idle path of every line
+  NetStats net;
+  PerTick("NetStats::Read", rounds, [&] {
+    net.Read(1.0);
+    return net.Interfaces().size();
+  });
+  PerPid("ProcParser::ReadStat", pids, rounds, [](int pid) {
+    ProcParser::Stat stat;
+    return ProcParser::ReadStat(pid, stat) ? stat.utime : 0;
+  });
+  PerPid("ProcParser::ReadStatus", pids, rounds, [](int pid) {
+    ProcParser::Status status;
+    return ProcParser::ReadStatus(pid, status) ? status.vmSizeKb : 0;
+  });
+  PerPid("ProcParser::ReadStatm", pids, rounds, [](int pid) {
+    ProcParser::Statm statm;
+    return ProcParser::ReadStatm(pid, statm) ? statm.resident : 0;
+  });
+  PerPid("ProcParser::ReadSmapsRollup", pids, rounds, [](int pid) {
+    ProcParser::SmapsRollup rollup;
+    return ProcParser::ReadSmapsRollup(pid, rollup) ? rollup.pssKb : 0;
+  });
+  PerPid("LinuxParser::Command", pids, rounds,
+         [](int pid) { return LinuxParser::Command(pid).size(); });
+  UserTable users(LinuxParser::EtcDirectory() + LinuxParser::kPasswordFilename);
+  PerPid("UserTable::Name", pids, rounds, [&users](int pid) {
+    ProcParser::Status status;
+    return ProcParser::ReadStatus(pid, status) ? users.Name(status.uid).size()
+                                               : 0;
+  });
+  return 0;
+}
+}  // namespace
+
+// usage: fixture_bench [processes...]
+int main(int argc, char* argv[]) {
+  // Size the descriptor cache the way the monitor does
+  ProcFileCache::RaiseDescriptorLimit();
+  std::vector<std::size_t> sizes;
+  for (int i = 1; i < argc; ++i) sizes.push_back(std::stoul(argv[i]));
+  if (sizes.empty()) sizes = {1000, 10000, 100000};
+  int rounds = 10;
+
+  int status = 0;
+  for (std::size_t size : sizes) {
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) std::exit(Run(size, rounds));
+    int result = 1;
+    if (child < 0 || waitpid(child, &result, 0) != child || result != 0)
+      status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,28 @@
+#include <cstdio>
+#include <string>
+
+#include "proc_fixture.h"
+
+/*
+Write a synthetic proc and etc tree to DIR, for running the monitor on it:
+  make_fixture DIR 10000
+  monitor --proc-root=DIR/proc --etc-root=DIR/etc
+*/
+
+// usage: make_fixture DIR [processes] [seed]
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: make_fixture DIR [processes] [seed]\n");
+    return 2;
+  }
+  ProcFixture::Options options;
+  if (argc > 2) options.processes = std::stoul(argv[2]);
+  if (argc > 3) options.seed = std::stoul(argv[3]);
+  ProcFixture fixture(argv[1], options);
+  if (!fixture.Create()) {
+    std::fprintf(stderr, "make_fixture: cannot create %s\n", argv[1]);
+    return 1;
+  }
+  fixture.Keep();
+  return 0;
+}
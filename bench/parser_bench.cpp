@@ -0,0 +1,111 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_parser.h"
+
+/*
+Micro-benchmark of the /proc/[pid]/stat and status parsers.
+Compares the istringstream based parsing the monitor used to do with the
+single-pass ProcParser, both on an in-memory line and on the live /proc.
+*/
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const std::string kStatLine =
+    "12345 (Web Content (x)) S 1 12345 12345 0 -1 4194560 1822034 0 27 0 "
+    "91245 23411 0 0 20 0 31 0 4413 3620421632 98123 18446744073709551615 1 "
+    "1 0 0 0 0 0 16781312 82175 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+
+// The per-field istringstream parsing previously used by LinuxParser
+uint64_t LegacyParseStat(const std::string& line) {
+  std::istringstream linestream(line);
+  std::string value;
+  for (int i = 0; i < 13; i++) linestream >> value;
+  uint64_t utime, stime, cutime, cstime, starttime;
+  linestream >> utime >> stime >> cutime >> cstime;
+  for (int i = 0; i < 4; i++) linestream >> value;
+  linestream >> starttime;
+  return utime + stime + starttime;
+}
+
+// The four ifstream reads one process row used to cost
+uint64_t LegacyReadProcess(int pid) {
+  const std::string dir = LinuxParser::ProcDirectory() + std::to_string(pid);
+  uint64_t sink = 0;
+  for (int i = 0; i < 2; i++) {  // UpTime(pid) and CpuUtilization(pid)
+    std::ifstream stream(dir + LinuxParser::kStatFilename);
+    std::string line;
+    std::getline(stream, line);
+    if (!line.empty()) sink += LegacyParseStat(line);
+  }
+  for (const char* key : {"VmSize", "Uid"}) {  // Ram(pid) and Uid(pid)
+    std::ifstream stream(dir + LinuxParser::kStatusFilename);
+    std::string line;
+    while (std::getline(stream, line)) {
+      if (line.find(key) != std::string::npos) {
+        std::istringstream linestream(line);
+        std::string keyword;
+        long value;
+        linestream >> keyword >> value;
+        sink += value;
+        break;
+      }
+    }
+  }
+  return sink;
+}
+
+uint64_t NewReadProcess(int pid) {
+  ProcParser::Stat stat;
+  ProcParser::Status status;
+  uint64_t sink = 0;
+  if (ProcParser::ReadStat(pid, stat)) sink += stat.utime + stat.startTime;
+  if (ProcParser::ReadStatus(pid, status)) sink += status.vmSizeKb;
+  return sink;
+}
+
+template <typename F>
+double NanosecondsPerOp(int iterations, F&& f) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) f();
+  auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+  return elapsed.count() / iterations;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 200000;
+  volatile uint64_t sink = 0;
+
+  double legacy = NanosecondsPerOp(iterations,
+                                   [&] { sink += LegacyParseStat(kStatLine); });
+  double parsed = NanosecondsPerOp(iterations, [&] {
+    ProcParser::Stat stat;
+    ProcParser::ParseStat(kStatLine.data(), kStatLine.size(), stat);
+    sink += stat.utime + stat.stime + stat.startTime;
+  });
+  std::printf(
+      "stat line parse   istringstream %8.1f ns   ProcParser %8.1f ns\n",
+      legacy, parsed);
+
+  std::vector<int> pids = LinuxParser::Pids();
+  int rounds = 20;
+  double legacyRow = NanosecondsPerOp(rounds, [&] {
+    for (int pid : pids) sink += LegacyReadProcess(pid);
+  });
+  double parsedRow = NanosecondsPerOp(rounds, [&] {
+    for (int pid : pids) sink += NewReadProcess(pid);
+  });
+  std::printf("per process row   istringstream %8.1f ns   ProcParser %8.1f ns"
+              "   (%zu pids)\n",
+              legacyRow / pids.size(), parsedRow / pids.size(), pids.size());
+  return 0;
+}
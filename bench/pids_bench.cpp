@@ -0,0 +1,89 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <string>
+#include <vector>
+
+#include "pid_enumerator.h"
+
+/*
+PID enumeration benchmark over a synthetic /proc-like directory holding
+the requested number of numeric directories plus some non-PID entries.
+Compares the std::experimental::filesystem scan LinuxParser::Pids() used
+to do with PidEnumerator.
+*/
+
+namespace {
+namespace fs = std::experimental::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// The filesystem based implementation LinuxParser::Pids() used to have
+std::vector<int> LegacyPids(const std::string& directory) {
+  std::vector<int> pids;
+  if (fs::exists(directory)) {
+    for (const auto& entry : fs::directory_iterator(directory)) {
+      if (entry.status().type() == fs::file_type::directory) {
+        std::string filename = entry.path().filename().string();
+        if (std::all_of(filename.begin(), filename.end(), isdigit)) {
+          pids.push_back(std::stoi(filename));
+        }
+      }
+    }
+  }
+  return pids;
+}
+
+template <typename F>
+double MillisecondsPerRound(int rounds, F&& f) {
+  auto start = Clock::now();
+  for (int round = 0; round < rounds; ++round) f();
+  auto elapsed =
+      std::chrono::duration<double, std::milli>(Clock::now() - start);
+  return elapsed.count() / rounds;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 50000;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  char root[] = "/tmp/pids_bench.XXXXXX";
+  if (mkdtemp(root) == nullptr) return 1;
+  std::string directory = std::string(root) + "/";
+  for (int pid = 1; pid <= count; ++pid) {
+    mkdir((directory + std::to_string(pid)).c_str(), 0755);
+  }
+  for (const char* name : {"sys", "net", "self", "irq"}) {
+    mkdir((directory + name).c_str(), 0755);
+  }
+  for (const char* name : {"stat", "meminfo", "uptime", "12345x"}) {
+    std::FILE* file = std::fopen((directory + name).c_str(), "w");
+    if (file != nullptr) std::fclose(file);
+  }
+
+  std::size_t found = 0;
+  double legacy = MillisecondsPerRound(
+      rounds, [&] { found = LegacyPids(directory).size(); });
+  std::printf("filesystem     %8.2f ms  (%zu pids)\n", legacy, found);
+
+  PidEnumerator enumerator(directory);
+  std::vector<int> pids;
+  double getdents = MillisecondsPerRound(rounds, [&] {
+    enumerator.Read(pids);
+    found = pids.size();
+  });
+  std::printf("getdents64     %8.2f ms  (%zu pids)\n", getdents, found);
+  double sorted = MillisecondsPerRound(rounds, [&] {
+    enumerator.Read(pids, true);
+    found = pids.size();
+  });
+  std::printf("getdents64+sort%8.2f ms  (%zu pids)\n", sorted, found);
+
+  fs::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,361 @@
+#include "proc_fixture.h"
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <utility>
+
+namespace {
+constexpr uint64_t kHz = 100;
+// The fixture machine has been up for an hour when it is created
+constexpr uint64_t kBootTicks = 3600 * kHz;
+constexpr int kUsers = 50;
+
+// comm values the stat parser has to get right; the kernel truncates
+// comm to 15 bytes
+const char* const kOddNames[] = {
+    "Web Content", "a) b (c", "((", "))", ") R 1 2 3", "tmux: server",
+    "kworker/3:1-ev", "x", "na\xc3\xafve",
+};
+const char* const kNames[] = {
+    "bash", "sshd", "systemd", "postgres", "nginx", "python3",
+    "java", "node", "chrome", "cron", "dbus-daemon", "rsyslogd",
+};
+
+void AppendFormat(std::string& buffer, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void AppendFormat(std::string& buffer, const char* format, ...) {
+  char text[512];
+  va_list args;
+  va_start(args, format);
+  int n = std::vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (n > 0) buffer.append(text, std::min<std::size_t>(n, sizeof(text) - 1));
+}
+
+// Replace the contents of path in place, so descriptors cached by the
+// monitor see the new data the way they would on /proc
+bool WriteFile(const std::string& path, const std::string& data) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  bool ok = write(fd, data.data(), data.size()) ==
+            static_cast<ssize_t>(data.size());
+  return close(fd) == 0 && ok;
+}
+
+int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+bool RemoveTree(const std::string& path) {
+  return nftw(path.c_str(), RemoveEntry, 64, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+// Attributes that never change for a PID, derived from the seed alone so
+// Advance() can rewrite a stat file without storing them
+struct Identity {
+  std::string comm;
+  bool kernelThread;
+  int ppid;
+  int uid;
+  char state;
+  int threads;
+  uint64_t vsizeKb;
+  uint64_t rssKb;
+  std::string cmdline;
+};
+
+Identity IdentityOf(int pid, unsigned seed) {
+  std::minstd_rand random(seed ^ (static_cast<unsigned>(pid) * 2654435761u));
+  Identity id;
+  unsigned kind = random() % 100;
+  id.kernelThread = kind < 10;
+  if (id.kernelThread) {
+    id.comm = "kworker/" + std::to_string(random() % 64) + ":" +
+              std::to_string(random() % 4);
+  } else if (kind < 20) {
+    id.comm = kOddNames[random() % (sizeof(kOddNames) / sizeof(*kOddNames))];
+  } else {
+    id.comm = kNames[random() % (sizeof(kNames) / sizeof(*kNames))];
+  }
+  id.ppid = id.kernelThread ? 2 : 1 + random() % std::max(pid, 1);
+  id.uid = random() % 4 == 0 ? 0 : 1000 + random() % (kUsers - 1);
+  id.state = "SSSSSSRDIZ"[random() % 10];
+  id.threads = random() % 8 == 0 ? 1 + random() % 64 : 1;
+  id.vsizeKb = id.kernelThread ? 0 : 2048 + random() % (4 << 20);
+  id.rssKb = id.vsizeKb == 0 ? 0 : id.vsizeKb / (2 + random() % 8);
+  if (!id.kernelThread) {
+    id.cmdline = "/usr/bin/" + id.comm;
+    id.cmdline += '\0';
+    std::size_t arguments = random() % 8;
+    // A few processes have the very long command lines of JVMs and
+    // browsers
+    if (random() % 50 == 0) arguments += 100;
+    for (std::size_t i = 0; i < arguments; ++i) {
+      id.cmdline += "--option-" + std::to_string(random() % 1000) +
+                    "=/some/path/value";
+      id.cmdline += '\0';
+    }
+  }
+  return id;
+}
+}  // namespace
+
+ProcFixture::ProcFixture(std::string root, Options options)
+    : root_(std::move(root)), options_(options), random_(options.seed) {}
+
+ProcFixture::~ProcFixture() {
+  if (!keep_) RemoveTree(root_);
+}
+
+void ProcFixture::Keep() { keep_ = true; }
+
+std::string ProcFixture::ProcDirectory() const { return root_ + "/proc/"; }
+
+std::string ProcFixture::EtcDirectory() const { return root_ + "/etc/"; }
+
+// Return the PIDs with a directory, including vanished ones
+const std::vector<int>& ProcFixture::Pids() const { return pids_; }
+
+bool ProcFixture::Create() {
+  RemoveTree(root_);
+  if ((mkdir(root_.c_str(), 0755) != 0 && errno != EEXIST) ||
+      mkdir(ProcDirectory().c_str(), 0755) != 0 ||
+      mkdir((ProcDirectory() + "net").c_str(), 0755) != 0 ||
+      mkdir(EtcDirectory().c_str(), 0755) != 0)
+    return false;
+
+  std::string passwd = "root:x:0:0:root:/root:/bin/bash\n";
+  for (int uid = 1000; uid < 1000 + kUsers - 1; ++uid)
+    AppendFormat(passwd, "user%d:x:%d:%d::/home/user%d:/bin/sh\n", uid, uid,
+                 uid, uid);
+  if (!WriteFile(EtcDirectory() + "passwd", passwd) ||
+      !WriteFile(EtcDirectory() + "os-release",
+                 "NAME=\"Fixture\"\nPRETTY_NAME=\"Fixture Linux 1.0\"\n"))
+    return false;
+
+  ticks_ = kBootTicks;
+  processes_.clear();
+  pids_.clear();
+  nextPid_ = 1;
+  for (std::size_t i = 0; i < options_.processes; ++i) {
+    // PIDs are sparse, as on a system that has been up for a while
+    nextPid_ += 1 + random_() % 4;
+    processes_.push_back(NewProcess(nextPid_));
+    if (!WriteProcess(processes_.back())) return false;
+  }
+  forks_ = nextPid_;
+  return WriteGlobals();
+}
+
+bool ProcFixture::Advance(std::size_t busy, std::size_t churn) {
+  ticks_ += kHz;
+  churn = std::min(churn, processes_.size());
+  for (std::size_t i = 0; i < churn; ++i) {
+    std::size_t index = random_() % processes_.size();
+    std::string dir = ProcDirectory() + std::to_string(processes_[index].pid);
+    if (!RemoveTree(dir)) return false;
+    nextPid_ += 1 + random_() % 4;
+    processes_[index] = NewProcess(nextPid_);
+    if (!WriteProcess(processes_[index])) return false;
+    ++forks_;
+  }
+  pids_.clear();
+  for (const Process& process : processes_) pids_.push_back(process.pid);
+  std::sort(pids_.begin(), pids_.end());
+  for (std::size_t i = 0; i < busy && !processes_.empty(); ++i) {
+    Process& process = processes_[random_() % processes_.size()];
+    if (process.vanished) continue;
+    process.utime += random_() % kHz;
+    process.stime += random_() % (kHz / 4);
+    if (!WriteStat(process)) return false;
+  }
+  return WriteGlobals();
+}
+
+ProcFixture::Process ProcFixture::NewProcess(int pid) {
+  Process process;
+  process.pid = pid;
+  process.startTime = random_() % ticks_;
+  uint64_t age = ticks_ - process.startTime;
+  process.utime = random_() % (age / 4 + 1);
+  process.stime = random_() % (age / 16 + 1);
+  process.vanished = random_() % 1000000 < options_.vanished * 1000000;
+  process.state =
+      process.vanished ? 'X' : IdentityOf(pid, options_.seed).state;
+  pids_.push_back(pid);
+  return process;
+}
+
+bool ProcFixture::WriteProcess(const Process& process) {
+  std::string dir = ProcDirectory() + std::to_string(process.pid);
+  if (mkdir(dir.c_str(), 0755) != 0) return false;
+  if (process.vanished) return true;
+  Identity id = IdentityOf(process.pid, options_.seed);
+
+  std::string status;
+  AppendFormat(status,
+               "Name:\t%s\nUmask:\t0022\nState:\t%c (sleeping)\nTgid:\t%d\n"
+               "Ngid:\t0\nPid:\t%d\nPPid:\t%d\nTracerPid:\t0\n"
+               "Uid:\t%d\t%d\t%d\t%d\nGid:\t%d\t%d\t%d\t%d\nFDSize:\t64\n"
+               "Groups:\t\nNStgid:\t%d\nNSpid:\t%d\nNSpgid:\t%d\n"
+               "NSsid:\t%d\nKthread:\t%d\n",
+               id.comm.c_str(), id.state, process.pid, process.pid, id.ppid,
+               id.uid, id.uid, id.uid, id.uid, id.uid, id.uid, id.uid, id.uid,
+               process.pid, process.pid, process.pid, process.pid,
+               id.kernelThread);
+  if (!id.kernelThread) {
+    AppendFormat(status,
+                 "VmPeak:\t%8lu kB\nVmSize:\t%8lu kB\nVmLck:\t       0 kB\n"
+                 "VmPin:\t       0 kB\nVmHWM:\t%8lu kB\nVmRSS:\t%8lu kB\n"
+                 "RssAnon:\t%8lu kB\nRssFile:\t%8lu kB\n"
+                 "RssShmem:\t       0 kB\nVmData:\t%8lu kB\n"
+                 "VmStk:\t     132 kB\nVmExe:\t      20 kB\n"
+                 "VmLib:\t    1528 kB\nVmPTE:\t      44 kB\n"
+                 "VmSwap:\t       0 kB\nHugetlbPages:\t       0 kB\n",
+                 static_cast<unsigned long>(id.vsizeKb),
+                 static_cast<unsigned long>(id.vsizeKb),
+                 static_cast<unsigned long>(id.rssKb),
+                 static_cast<unsigned long>(id.rssKb),
+                 static_cast<unsigned long>(id.rssKb / 2),
+                 static_cast<unsigned long>(id.rssKb - id.rssKb / 2),
+                 static_cast<unsigned long>(id.vsizeKb / 3));
+  }
+  AppendFormat(status,
+               "CoreDumping:\t0\nTHP_enabled:\t1\nThreads:\t%d\n"
+               "SigQ:\t0/23960\nSigPnd:\t0000000000000000\n"
+               "ShdPnd:\t0000000000000000\nSigBlk:\t0000000000000000\n"
+               "SigIgn:\t0000000000001000\nSigCgt:\t0000000180004002\n"
+               "CapInh:\t0000000000000000\nCapPrm:\t0000000000000000\n"
+               "CapEff:\t0000000000000000\nCapBnd:\t000001ffffffffff\n"
+               "CapAmb:\t0000000000000000\nNoNewPrivs:\t0\nSeccomp:\t0\n"
+               "Seccomp_filters:\t0\n",
+               id.threads);
+  AppendFormat(status,
+               "Speculation_Store_Bypass:\tthread vulnerable\n"
+               "Cpus_allowed:\tff\nCpus_allowed_list:\t0-7\n"
+               "Mems_allowed:\t00000000,00000001\nMems_allowed_list:\t0\n"
+               "voluntary_ctxt_switches:\t%u\n"
+               "nonvoluntary_ctxt_switches:\t%u\n",
+               static_cast<unsigned>(random_() % 100000),
+               static_cast<unsigned>(random_() % 1000));
+
+  std::string statm;
+  AppendFormat(statm, "%lu %lu %lu 5 0 %lu 0\n",
+               static_cast<unsigned long>(id.vsizeKb / 4),
+               static_cast<unsigned long>(id.rssKb / 4),
+               static_cast<unsigned long>(id.rssKb / 8),
+               static_cast<unsigned long>(id.vsizeKb / 12));
+
+  std::string rollup;
+  AppendFormat(rollup,
+               "00400000-7ffc00000000 ---p 00000000 00:00 0    [rollup]\n"
+               "Rss:            %8lu kB\nPss:            %8lu kB\n"
+               "Pss_Anon:       %8lu kB\nSwap:                  0 kB\n"
+               "SwapPss:               0 kB\nLocked:                0 kB\n",
+               static_cast<unsigned long>(id.rssKb),
+               static_cast<unsigned long>(id.rssKb * 3 / 4),
+               static_cast<unsigned long>(id.rssKb / 2));
+
+  return WriteStat(process) && WriteFile(dir + "/status", status) &&
+         WriteFile(dir + "/statm", statm) &&
+         WriteFile(dir + "/smaps_rollup", rollup) &&
+         WriteFile(dir + "/cmdline", id.cmdline);
+}
+
+bool ProcFixture::WriteStat(const Process& process) {
+  Identity id = IdentityOf(process.pid, options_.seed);
+  std::string stat;
+  AppendFormat(stat,
+               "%d (%s) %c %d %d %d 0 -1 4194560 %lu 0 27 0 %lu %lu 0 0 20 "
+               "0 %d 0 %lu %lu %lu 18446744073709551615 1 1 0 0 0 0 0 "
+               "16781312 82175 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+               process.pid, id.comm.c_str(), id.state, id.ppid, process.pid,
+               process.pid, static_cast<unsigned long>(process.utime / 3),
+               static_cast<unsigned long>(process.utime),
+               static_cast<unsigned long>(process.stime), id.threads,
+               static_cast<unsigned long>(process.startTime),
+               static_cast<unsigned long>(id.vsizeKb * 1024),
+               static_cast<unsigned long>(id.rssKb / 4));
+  return WriteFile(ProcDirectory() + std::to_string(process.pid) + "/stat",
+                   stat);
+}
+
+bool ProcFixture::WriteGlobals() {
+  // Split every CPU's time into the usual states; the machine is about a
+  // third busy
+  uint64_t user = ticks_ / 4;
+  uint64_t system = ticks_ / 12;
+  uint64_t iowait = ticks_ / 100;
+  uint64_t idle = ticks_ - user - system - iowait;
+  std::string stat;
+  std::size_t cores = std::max<std::size_t>(options_.cores, 1);
+  AppendFormat(stat, "cpu  %lu 0 %lu %lu %lu 0 7 0 0 0\n",
+               static_cast<unsigned long>(user * cores),
+               static_cast<unsigned long>(system * cores),
+               static_cast<unsigned long>(idle * cores),
+               static_cast<unsigned long>(iowait * cores));
+  for (std::size_t cpu = 0; cpu < cores; ++cpu)
+    AppendFormat(stat, "cpu%zu %lu 0 %lu %lu %lu 0 0 0 0 0\n", cpu,
+                 static_cast<unsigned long>(user),
+                 static_cast<unsigned long>(system),
+                 static_cast<unsigned long>(idle),
+                 static_cast<unsigned long>(iowait));
+  std::size_t running = 0;
+  for (const Process& process : processes_) running += process.state == 'R';
+  AppendFormat(stat,
+               "intr %lu 0 0 0\nctxt %lu\nbtime 1700000000\nprocesses %lu\n"
+               "procs_running %zu\nprocs_blocked 0\n",
+               static_cast<unsigned long>(ticks_ * 37),
+               static_cast<unsigned long>(ticks_ * 211),
+               static_cast<unsigned long>(forks_), running);
+
+  std::string uptime;
+  AppendFormat(uptime, "%lu.%02lu %lu.00\n",
+               static_cast<unsigned long>(ticks_ / kHz),
+               static_cast<unsigned long>(ticks_ % kHz),
+               static_cast<unsigned long>(idle * cores / kHz));
+
+  std::string net =
+      "Inter-|   Receive                                                |"
+      "  Transmit\n"
+      " face |bytes    packets errs drop fifo frame compressed multicast|"
+      "bytes    packets errs drop fifo colls carrier compressed\n";
+  auto device = [&net](const char* name, uint64_t bytes, uint64_t packets) {
+    AppendFormat(net, "%6s: %lu %lu 0 0 0 0 0 0 %lu %lu 0 0 0 0 0 0\n", name,
+                 static_cast<unsigned long>(bytes),
+                 static_cast<unsigned long>(packets),
+                 static_cast<unsigned long>(bytes / 2),
+                 static_cast<unsigned long>(packets / 2));
+  };
+  device("lo", ticks_ * 4096, ticks_ * 8);
+  device("eth0", ticks_ * 150000, ticks_ * 110);
+  for (std::size_t i = 0; i < options_.veths; ++i) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "veth%zu", i);
+    device(name, 1000 + i * 7919, 10 + i);
+  }
+
+  std::string proc = ProcDirectory();
+  return WriteFile(proc + "stat", stat) && WriteFile(proc + "net/dev", net) &&
+         WriteFile(proc + "meminfo",
+                   "MemTotal:       16314488 kB\n"
+                   "MemFree:         4325312 kB\n"
+                   "MemAvailable:   11423004 kB\n"
+                   "Buffers:          402936 kB\n"
+                   "Cached:          6710964 kB\n"
+                   "SwapCached:            0 kB\n"
+                   "SwapTotal:       2097148 kB\n"
+                   "SwapFree:        1835004 kB\n") &&
+         WriteFile(proc + "uptime", uptime) &&
+         WriteFile(proc + "loadavg", "1.25 0.98 0.77 3/812 41234\n") &&
+         WriteFile(proc + "version",
+                   "Linux version 6.1.0-fixture (builder@fixture) #1 SMP\n");
+}
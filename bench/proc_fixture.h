@@ -0,0 +1,77 @@
+#ifndef PROC_FIXTURE_H
+#define PROC_FIXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Synthetic proc and etc trees for benchmarks, laid out as root/proc and
+root/etc so they can be passed to LinuxParser::SetRoots() or to the
+monitor's --proc-root/--etc-root options.
+Processes get realistic stat, status, statm and cmdline files, including
+comm names with spaces and parentheses and kernel threads without a
+command line. A fraction of the PID directories is left empty, the way a
+process that exits between the directory scan and the reads looks.
+Global files include a net/dev where only lo and eth0 carry traffic.
+Everything is derived from the seed, so runs are reproducible.
+*/
+class ProcFixture {
+ public:
+  struct Options {
+    std::size_t processes = 1000;
+    std::size_t cores = 8;
+    // Interfaces in net/dev besides lo and eth0, idle veth devices the way
+    // a container host has them
+    std::size_t veths = 200;
+    // Fraction of PID directories without any files
+    double vanished = 0.01;
+    unsigned seed = 1;
+  };
+
+  // Nothing is written until Create()
+  ProcFixture(std::string root, Options options);
+  // Removes the tree unless Keep() was called
+  ~ProcFixture();
+  ProcFixture(const ProcFixture&) = delete;
+  ProcFixture& operator=(const ProcFixture&) = delete;
+
+  bool Create();
+  // Move one tick forward: the global counters and busy processes' CPU
+  // times advance, churn processes exit and as many new ones start
+  bool Advance(std::size_t busy, std::size_t churn);
+  void Keep();
+
+  std::string ProcDirectory() const;
+  std::string EtcDirectory() const;
+  const std::vector<int>& Pids() const;
+
+ private:
+  struct Process {
+    int pid;
+    uint64_t utime;
+    uint64_t stime;
+    uint64_t startTime;
+    char state;
+    bool vanished;
+  };
+
+  Process NewProcess(int pid);
+  bool WriteProcess(const Process& process);
+  bool WriteStat(const Process& process);
+  bool WriteGlobals();
+
+  const std::string root_;
+  const Options options_;
+  std::mt19937 random_;
+  bool keep_ = false;
+  std::vector<Process> processes_ = {};
+  std::vector<int> pids_ = {};
+  int nextPid_ = 1;
+  uint64_t ticks_ = 0;
+  uint64_t forks_ = 0;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <curses.h>
+
+#include <string>
+#include <vector>
+
+/*
+A curses window that remembers what was drawn on each of its rows.
+A row is composed from text segments into a reused buffer and only
+written to the window when it differs from the previous frame, so rows
+that didn't change cost neither curses work nor terminal output. Windows
+are refreshed with wnoutrefresh(), leaving a single doupdate() per frame
+to the caller.
+*/
+class Canvas {
+ public:
+  Canvas() = default;
+  ~Canvas();
+  Canvas(const Canvas&) = delete;
+  Canvas& operator=(const Canvas&) = delete;
+
+  // (Re)create the window, clipped to the screen; a canvas that doesn't
+  // fit at all is left invalid and ignores drawing
+  void Create(int height, int width, int y, int x, bool border = true);
+  void Destroy();
+  bool Valid() const;
+  int Height() const;
+  int Width() const;
+  // Screen row just below the window
+  int Bottom() const;
+
+  // Compose row out of segments at absolute columns, in color pair pair
+  void Begin(int row);
+  void Text(int column, const char* text, int pair = 0);
+  void Format(int column, int pair, const char* format, ...)
+      __attribute__((format(printf, 4, 5)));
+  void End();
+  // Blank the rows from row on that were drawn before
+  void ClearFrom(int row);
+  // Queue the window's changes for the next doupdate()
+  void Stage();
+
+ private:
+  void Draw(int row);
+
+  WINDOW* window_ = nullptr;
+  int inset_ = 0;
+  // Encoded segments of every row as last drawn, and of the row being
+  // composed
+  std::vector<std::string> shadow_ = {};
+  std::string row_ = {};
+  int current_ = -1;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef CGROUP_TABLE_H
+#define CGROUP_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Processes grouped by their cgroup v2, e.g. one group per container.
+The cgroup of a PID is read from /proc/[pid]/cgroup once and kept until
+the PID disappears from a scan. Group totals come straight from the
+group's own cpu.stat, memory.current, io.stat and cpu.pressure, whose
+descriptors stay open, so a refresh costs a few reads per group however
+many processes it holds. Files that a group lacks, such as those of
+controllers that aren't enabled for it, read as unknown.
+*/
+class CgroupTable {
+ public:
+  struct Group {
+    // Stable while the group has processes
+    int id = 0;
+    // Relative to the cgroup2 mount, "/" for the root group
+    std::string path;
+    int processes = 0;
+    // Share of all CPUs over the interval
+    float cpuUtilization = 0.0;
+    // Share of the interval some task of the group stalled on the CPU
+    float cpuStall = 0.0;
+    // memory.current in bytes
+    uint64_t memoryBytes = 0;
+    // Bytes per second, summed over devices
+    float readRate = 0.0;
+    float writeRate = 0.0;
+    bool memoryKnown = false;
+    bool ioKnown = false;
+    bool stallKnown = false;
+    // Member PIDs in ascending order; only filled for expanded groups
+    std::vector<int> members;
+  };
+
+  CgroupTable();
+  ~CgroupTable();
+  CgroupTable(const CgroupTable&) = delete;
+  CgroupTable& operator=(const CgroupTable&) = delete;
+
+  // False without a cgroup2 mount
+  bool Available() const;
+  // Map pids, the complete list of a scan, to their groups and read the
+  // totals of every group with processes. Rates cover elapsed seconds;
+  // cpus scales CPU time to a share of the machine. Groups in expanded
+  // get their members listed.
+  void Update(const std::vector<int>& pids, double elapsed, long cpus,
+              const std::vector<int>& expanded);
+  // Groups with processes, in no particular order
+  std::vector<Group>& Groups();
+  const std::vector<Group>& Groups() const;
+  // Append the members of the groups in ids to pids
+  void Members(const std::vector<int>& ids, std::vector<int>& pids) const;
+
+ private:
+  enum File { kCpuStat, kMemory, kIoStat, kCpuPressure, kFiles };
+
+  struct State {
+    std::string path;
+    int fds[kFiles] = {-1, -1, -1, -1};
+    int processes = 0;
+    // Counters of the previous read
+    bool sampled = false;
+    uint64_t usageUs = 0;
+    uint64_t stallUs = 0;
+    uint64_t readBytes = 0;
+    uint64_t writtenBytes = 0;
+  };
+
+  struct Membership {
+    int group;
+    uint64_t seen;
+  };
+
+  int GroupOf(int pid);
+  void Read(State& state, Group& group, double elapsed, long cpus);
+  void Close(State& state);
+
+  std::string mount_ = {};
+  uint64_t tick_ = 0;
+  int nextId_ = 1;
+  std::unordered_map<int, Membership> members_ = {};
+  std::unordered_map<int, State> states_ = {};
+  std::unordered_map<std::string, int> byPath_ = {};
+  std::vector<Group> groups_ = {};
+  char buffer_[4096];
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef DISK_STATS_H
+#define DISK_STATS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Per-device throughput, IOPS and utilization from /proc/diskstats, as
+deltas between consecutive reads. Only whole disks that have done any I/O
+since boot are reported: partitions would count the same requests twice,
+and loop and ram devices are noise.
+*/
+class DiskStats {
+ public:
+  struct Device {
+    std::string name;
+    // Bytes per second
+    float readRate = 0.0;
+    float writeRate = 0.0;
+    // Completed requests per second
+    float iops = 0.0;
+    // Fraction of the interval with requests in flight
+    float utilization = 0.0;
+  };
+
+  // Read the counters; rates cover the elapsed seconds since the previous
+  // read and are 0 for devices seen for the first time
+  bool Read(double elapsed);
+  const std::vector<Device>& Devices() const;
+
+ private:
+  struct Counters {
+    uint64_t reads = 0;
+    uint64_t sectorsRead = 0;
+    uint64_t writes = 0;
+    uint64_t sectorsWritten = 0;
+    uint64_t ioMs = 0;
+  };
+
+  std::string buffer_ = {};
+  std::unordered_map<std::string, Counters> previous_ = {};
+  std::vector<Device> devices_ = {};
+  std::vector<Counters> counters_ = {};
+};
+
+#endif
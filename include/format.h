@@ -1,10 +1,15 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
+#include <cstddef>
 #include <string>
 
 namespace Format {
 std::string ElapsedTime(long times);
+// HH:MM:SS into buffer, without allocating
+void ElapsedTime(long seconds, char* buffer, std::size_t size);
+// Bytes per second with a binary unit, "  12.3 MB/s", into buffer
+void Rate(float bytesPerSecond, char* buffer, std::size_t size);
 };                                    // namespace Format
 
 #endif
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "options.h"
+#include "system.h"
+
+namespace Headless {
+// Sample system every options.interval and stream the snapshots; return
+// the process exit status
+int Run(System& system, const Options& options);
+};  // namespace Headless
+
+#endif
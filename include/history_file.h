@@ -0,0 +1,84 @@
+#ifndef HISTORY_FILE_H
+#define HISTORY_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+
+/*
+Fixed-size, memory-mapped ring buffer of snapshots on disk.
+Records are appended at the head and the oldest ones are overwritten once
+the file is full, so disk use never exceeds the size it was created with.
+Nothing is synced on the write path; the kernel writes the pages back on
+its own schedule.
+
+Each record is a u32 length followed by the varint encoded snapshot.
+Monotonic counters (tick, time, uptime, forks, context switches,
+interrupts) are stored as deltas against the previous record, with a
+self-contained keyframe every kKeyInterval records so decoding can start
+anywhere after the oldest records have been overwritten. Percentages are
+stored in units of 0.01%, rates in bytes or tenths of an event per second
+and load averages in hundredths.
+*/
+class HistoryFile {
+ public:
+  static constexpr std::size_t kDefaultSize = 64 << 20;
+  static constexpr uint32_t kKeyInterval = 64;
+
+  HistoryFile() = default;
+  ~HistoryFile();
+  HistoryFile(const HistoryFile&) = delete;
+  HistoryFile& operator=(const HistoryFile&) = delete;
+
+  // Open path for appending, creating it with size bytes if it doesn't
+  // exist yet or isn't a history file
+  bool Create(const std::string& path, std::size_t size = kDefaultSize);
+  // Open path read-only for replay
+  bool Open(const std::string& path);
+
+  bool Append(const Snapshot& snapshot);
+
+  // Index the records currently in the file and return their number; the
+  // oldest ones before the first keyframe can't be decoded and are skipped
+  std::size_t Load();
+  std::size_t Count() const;
+  // Decode record index (0 is the oldest) of the last Load()
+  bool Read(std::size_t index, Snapshot& snapshot);
+
+ private:
+  struct Header;
+  // Values delta encoded against the previous record
+  struct Counters {
+    uint64_t tick = 0;
+    int64_t time = 0;
+    int64_t upTime = 0;
+    int64_t totalProcesses = 0;
+    uint64_t contextSwitches = 0;
+    uint64_t interrupts = 0;
+  };
+
+  bool Map(int fd, std::size_t size, bool write);
+  void Unmap();
+  std::size_t Next(std::size_t offset) const;
+  bool Decode(std::size_t offset, Counters& counters, Snapshot* snapshot);
+
+  int fd_ = -1;
+  char* map_ = nullptr;
+  std::size_t size_ = 0;
+  Header* header_ = nullptr;
+
+  // Writer
+  Counters written_ = {};
+  bool needKey_ = true;
+  std::string record_ = {};
+
+  // Reader
+  std::vector<std::size_t> index_ = {};
+  std::size_t decoded_ = 0;
+  Counters read_ = {};
+};
+
+#endif
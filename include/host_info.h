@@ -0,0 +1,26 @@
+#ifndef HOST_INFO_H
+#define HOST_INFO_H
+
+#include <string>
+
+/*
+Facts about the machine that practically never change while the monitor
+runs: the OS release, the kernel version, the clock tick rate, the number
+of online CPUs and the page size. They are the rare tier of the refresh
+policy and are read at startup and then only every kRefreshInterval ticks,
+instead of once per process or per frame.
+*/
+struct HostInfo {
+  static constexpr unsigned kRefreshInterval = 300;
+
+  void Read();
+
+  std::string operatingSystem = {};
+  std::string kernel = {};
+  // sysconf(_SC_CLK_TCK), the unit of per-process times
+  long clockTicks = 100;
+  long onlineCpus = 1;
+  long pageKb = 4;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Self-instrumentation of the monitor: how long each phase of a refresh and
+of drawing takes, and the syscalls, bytes read, allocations and processes
+it costs. Work is counted per thread and credited to the phase the thread
+is in, so worker threads and the UI thread don't blur each other's
+numbers. Durations go into log2 histograms for percentiles.
+
+Allocations are counted by the operator new in instrument_new.cpp, which
+only the monitor binary links; elsewhere they read 0.
+
+Everything is compiled out when MONITOR_INSTRUMENT is 0 (the CMake option
+of the same name); the macros then expand to nothing and Read() reports
+no phases.
+*/
+
+#ifndef MONITOR_INSTRUMENT
+#define MONITOR_INSTRUMENT 0
+#endif
+
+namespace Instrument {
+enum class Phase {
+  kSnapshot,   // global proc files
+  kCpu,        // per-core deltas
+  kEnumerate,  // listing PIDs
+  kParse,      // /proc/[pid]/stat of every process
+  kUpdate,     // process table maintenance
+  kIo,         // /proc/[pid]/io of processes that ran
+  kCgroups,    // cgroup membership and group totals
+  kFilter,     // matching new processes against the filter
+  kSort,       // ranking
+  kDetails,    // command, user and memory of displayed rows
+  kThreads,    // threads of expanded processes
+  kDraw,       // ncurses rendering
+  kNone,
+};
+constexpr std::size_t kPhases = static_cast<std::size_t>(Phase::kNone);
+
+enum class Counter { kSyscalls, kBytesRead, kAllocations, kProcesses };
+constexpr std::size_t kCounters = 4;
+
+constexpr bool kEnabled = MONITOR_INSTRUMENT;
+
+const char* Name(Phase phase);
+
+struct PhaseStats {
+  Phase phase = Phase::kNone;
+  uint64_t calls = 0;
+  // Durations in microseconds, percentiles at histogram bucket precision
+  uint64_t lastUs = 0;
+  uint64_t p50Us = 0;
+  uint64_t p99Us = 0;
+  // Counted during the most recent call
+  std::array<uint64_t, kCounters> counters = {};
+};
+
+// Replace stats with the phases that have run at least once
+void Read(std::vector<PhaseStats>& stats);
+
+#if MONITOR_INSTRUMENT
+// Times the enclosing block as phase
+class Scope {
+ public:
+  explicit Scope(Phase phase);
+  ~Scope();
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const Phase phase_;
+  const Phase previous_;
+  const uint64_t start_;
+  std::array<uint64_t, kCounters> counters_;
+};
+
+// Credit the counts of a helper thread to a phase running elsewhere,
+// without timing it
+class Adopt {
+ public:
+  explicit Adopt(Phase phase);
+  ~Adopt();
+  Adopt(const Adopt&) = delete;
+  Adopt& operator=(const Adopt&) = delete;
+
+ private:
+  const Phase previous_;
+};
+
+// Phase of the calling thread
+Phase Current();
+void Count(Counter counter, uint64_t n);
+#endif
+}  // namespace Instrument
+
+#if MONITOR_INSTRUMENT
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_NAME_(line) INSTRUMENT_CONCAT_(instrument_, line)
+#define INSTRUMENT_SCOPE(phase) \
+  ::Instrument::Scope INSTRUMENT_NAME_(__LINE__)(::Instrument::Phase::phase)
+#define INSTRUMENT_ADOPT(phase) \
+  ::Instrument::Adopt INSTRUMENT_NAME_(__LINE__)(phase)
+#define INSTRUMENT_COUNT(counter, n) \
+  ::Instrument::Count(::Instrument::Counter::counter, n)
+#else
+#define INSTRUMENT_SCOPE(phase) static_cast<void>(0)
+#define INSTRUMENT_ADOPT(phase) static_cast<void>(0)
+#define INSTRUMENT_COUNT(counter, n) static_cast<void>(0)
+#endif
+
+#endif
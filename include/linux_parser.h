@@ -1,29 +1,41 @@
 #ifndef SYSTEM_PARSER_H
 #define SYSTEM_PARSER_H
 
+#include <array>
+#include <cstdint>
 #include <fstream>
 #include <regex>
 #include <string>
+#include <vector>
 
 namespace LinuxParser {
+// Roots of the proc and etc trees, "/proc/" and "/etc/" by default. Open
+// files and tables are cached, so SetRoots() must run before the first read.
+const std::string& ProcDirectory();
+const std::string& EtcDirectory();
+void SetRoots(const std::string& proc, const std::string& etc);
+
 // Paths
-const std::string kProcDirectory{"/proc/"};
 const std::string kCmdlineFilename{"/cmdline"};
 const std::string kCpuinfoFilename{"/cpuinfo"};
 const std::string kStatusFilename{"/status"};
 const std::string kStatFilename{"/stat"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
+const std::string kLoadavgFilename{"/loadavg"};
+const std::string kDiskstatsFilename{"/diskstats"};
+const std::string kNetDevFilename{"/net/dev"};
+const std::string kPressureCpuFilename{"/pressure/cpu"};
+const std::string kPressureMemoryFilename{"/pressure/memory"};
+const std::string kPressureIoFilename{"/pressure/io"};
+const std::string kStatmFilename{"/statm"};
 const std::string kVersionFilename{"/version"};
-const std::string kOSPath{"/etc/os-release"};
-const std::string kPasswordPath{"/etc/passwd"};
+const std::string kOSFilename{"os-release"};
+const std::string kPasswordFilename{"passwd"};
 
 // System
-float MemoryUtilization();
 long UpTime();
 std::vector<int> Pids();
-int TotalProcesses();
-int RunningProcesses();
 std::string OperatingSystem();
 std::string Kernel();
 
@@ -40,15 +52,22 @@ enum CPUStates {
   kGuest_,
   kGuestNice_
 };
-std::vector<uint64_t> CpuUtilization();
+constexpr std::size_t kCPUStates = kGuestNice_ + 1;
+
+// Jiffies of every "cpu" line in /proc/stat as a structure of arrays with
+// one contiguous array per state. Slot 0 is the aggregate line and slot
+// N + 1 is "cpuN"; slots of offline CPUs are marked as not present.
+struct CpuTimes {
+  std::array<std::vector<uint64_t>, kCPUStates> states;
+  std::vector<uint8_t> present;
+
+  std::size_t Slots() const { return present.size(); }
+  void Resize(std::size_t slots);
+};
 
 // Processes
 std::string Command(int pid);
-std::string Ram(int pid);
-std::string Uid(int pid);
-std::string User(int pid);
-long int UpTime(int pid);
-float CpuUtilization(int pid);
+std::string UserName(int uid);
 };  // namespace LinuxParser
 
 #endif
\ No newline at end of file
@@ -3,14 +3,62 @@
 
 #include <curses.h>
 
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "canvas.h"
+#include "disk_stats.h"
+#include "history_file.h"
+#include "instrument.h"
+#include "net_stats.h"
 #include "process.h"
+#include "snapshot.h"
 #include "system.h"
 
 namespace NCursesDisplay {
-void Display(System& system, int n = 10);
-void DisplaySystem(System& system, WINDOW* window);
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
-std::string ProgressBar(float percent);
+// Collection runs every samplePeriod on a background thread; a frame is
+// drawn for every new snapshot, but at most once per renderPeriod, and
+// right away on input. 'q' quits, 'm' and 'o' switch between sorting by
+// CPU and by memory or I/O, '<' and '>' step through the sort columns,
+// 'i' toggles the instrumentation footer. Up and down select a process,
+// Enter or 't' expands it into its threads. 'g' groups processes by
+// cgroup, where Enter lists the members of a group. 'f' edits the process
+// filter, '/' searches the rows as it is typed and 'n' finds the next
+// match. A nonzero stallTrigger also samples as soon as PSI reports a
+// stall.
+void Display(System& system, int n = 10,
+             std::chrono::milliseconds samplePeriod = std::chrono::seconds(1),
+             std::chrono::milliseconds renderPeriod = std::chrono::seconds(1),
+             HistoryFile* history = nullptr,
+             System::SortKey sortKey = System::SortKey::kCpu,
+             std::chrono::microseconds stallTrigger = {});
+// Browse a recorded history file; return the process exit status
+int Replay(const std::string& path, int n = 10);
+void DisplaySystem(const Snapshot& snapshot, Canvas& canvas);
+int CoreRows(std::size_t cores, int width);
+// Draw the per-core grid from row on; return the row after it
+int DisplayCores(const std::vector<float>& cores, Canvas& canvas, int row);
+// Draw the busiest interfaces as receive and transmit bars, scaled to the
+// peak rate of each interface, from row on; return the row after them
+int DisplayNetwork(const std::vector<NetStats::Interface>& interfaces,
+                   Canvas& canvas, int row);
+// Draw up to n rows of processes, each followed by its busiest threads
+// if it is expanded. The header of the sort column and the row of the
+// selected pid are highlighted.
+void DisplayProcesses(const Snapshot& snapshot, Canvas& canvas, int n,
+                      int selected = 0);
+// Draw up to n rows of cgroups, each followed by its busiest members if
+// it is expanded; the row of the selected group id is highlighted
+void DisplayGroups(const Snapshot& snapshot, Canvas& canvas, int n,
+                   int selected = 0);
+void DisplayDisks(const std::vector<DiskStats::Device>& disks,
+                  Canvas& canvas);
+void DisplayInstrumentation(const std::vector<Instrument::PhaseStats>& phases,
+                            Canvas& canvas);
+// Write the bar for percent, "0%||||   ... 42.0/100%", into buffer
+void ProgressBar(float percent, char* buffer, std::size_t size);
 };  // namespace NCursesDisplay
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,72 @@
+#ifndef NET_STATS_H
+#define NET_STATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+Per-interface throughput from /proc/net/dev, as deltas between consecutive
+reads. Only interfaces whose counters moved during the interval are
+reported, busiest first. A line identical to the previous read is idle and
+isn't parsed at all, so hosts with hundreds of quiet veth devices pay a
+comparison per interface.
+*/
+class NetStats {
+ public:
+  struct Interface {
+    std::string name;
+    // Bytes per second
+    float rxRate = 0.0;
+    float txRate = 0.0;
+    // Packets per second
+    float rxPackets = 0.0;
+    float txPackets = 0.0;
+    // Receive and transmit errors and drops per second
+    float errors = 0.0;
+    float drops = 0.0;
+    // Highest rxRate or txRate seen on the interface, the full scale of its
+    // rate bars
+    float peak = 0.0;
+  };
+
+  // Read the counters; rates cover the elapsed seconds since the previous
+  // read and are 0 for interfaces seen for the first time
+  bool Read(double elapsed);
+  const std::vector<Interface>& Interfaces() const;
+
+ private:
+  enum Counter {
+    kRxBytes,
+    kRxPackets,
+    kRxErrors,
+    kRxDrops,
+    kTxBytes,
+    kTxPackets,
+    kTxErrors,
+    kTxDrops,
+    kCounters
+  };
+
+  // What is kept of an interface between reads
+  struct State {
+    std::string name;
+    // The line after the colon, to spot idle interfaces
+    std::string line;
+    uint64_t counters[kCounters] = {};
+    float peak = 0.0;
+  };
+
+  // Index of the interface in states_, trying hint first; states_.size()
+  // if it is new
+  std::size_t Find(const char* name, std::size_t length,
+                   std::size_t hint) const;
+
+  std::string buffer_ = {};
+  // In file order, which only changes when interfaces come and go
+  std::vector<State> states_ = {};
+  std::vector<State> next_ = {};
+  std::vector<Interface> interfaces_ = {};
+};
+
+#endif
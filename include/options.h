@@ -0,0 +1,57 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "history_file.h"
+#include "stall_triggers.h"
+#include "system.h"
+
+/*
+Command line options of the monitor
+*/
+struct Options {
+  enum class Mode { kDisplay, kHeadless, kReplay };
+  enum class Format { kNdjson, kBinary };
+
+  Mode mode = Mode::kDisplay;
+  Format format = Format::kNdjson;
+  // Headless output file; empty writes to stdout
+  std::string output;
+  std::chrono::milliseconds interval{1000};
+  // Minimum time between UI frames; 0 means the sampling interval
+  std::chrono::milliseconds renderInterval{0};
+  // Processes per snapshot; 0 means all of them
+  std::size_t rows = 10;
+  // Stop after this many snapshots; 0 runs until interrupted
+  std::size_t count = 0;
+  // Ring buffer file every snapshot is recorded to, if any
+  std::string history;
+  std::size_t historySize = HistoryFile::kDefaultSize;
+  // Recording to browse in replay mode
+  std::string replay;
+  // Alternative proc and etc trees, e.g. a benchmark fixture
+  std::string procRoot;
+  std::string etcRoot;
+  // Size of the /proc collection pool, 0 for one per hardware thread
+  std::size_t threads = 0;
+  System::SortKey sortKey = System::SortKey::kCpu;
+  // Process filter, see ProcessFilter
+  std::string filter;
+  // Measure PSS and swap of the reported processes
+  bool accurateMemory = false;
+  // Processes whose threads are reported too
+  std::vector<int> expand;
+  // Report totals per cgroup instead of every process
+  bool group = false;
+  // PSI stall threshold that triggers an early sample, 0 for none
+  std::chrono::microseconds stallTrigger{0};
+};
+
+// Parse argv into options; on error print usage to stderr and return false
+bool ParseOptions(int argc, char* argv[], Options& options);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PID_ENUMERATOR_H
+#define PID_ENUMERATOR_H
+
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+
+/*
+Lists the numeric directories of /proc with raw getdents64 calls.
+The directory stays open and is rewound between calls, entries are read
+into a reused buffer, and names are parsed in place, so a scan performs no
+allocation once the output vector has grown.
+*/
+class PidEnumerator {
+ public:
+  explicit PidEnumerator(std::string directory = LinuxParser::ProcDirectory());
+  ~PidEnumerator();
+  PidEnumerator(const PidEnumerator&) = delete;
+  PidEnumerator& operator=(const PidEnumerator&) = delete;
+
+  // Replace the contents of pids with the current PIDs, in ascending order
+  // if sorted is set
+  bool Read(std::vector<int>& pids, bool sorted = false);
+
+ private:
+  const std::string directory_;
+  int fd_ = -1;
+  std::vector<char> buffer_;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PRESSURE_STATS_H
+#define PRESSURE_STATS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+Pressure Stall Information from /proc/pressure/{cpu,memory,io}: how much
+of the time tasks were waiting for a resource, rather than how busy it
+was. Besides the kernel's running averages, the share of the last
+interval is computed from the microsecond totals. Kernels built without
+PSI, or booted with psi=0, have no such files; their resources are
+reported as unavailable and never read again.
+*/
+class PressureStats {
+ public:
+  enum Resource { kCpu, kMemory, kIo, kResources };
+
+  // One line of a pressure file, as fractions of wall time
+  struct Stall {
+    float avg10 = 0.0;
+    float avg60 = 0.0;
+    // Share of the interval since the previous read, 0 on the first one
+    float interval = 0.0;
+    uint64_t totalUs = 0;
+  };
+
+  // "some": at least one task was stalled; "full": all non-idle tasks
+  // were, which the kernel reports as 0 for the CPU of the whole system
+  struct Pressure {
+    bool available = false;
+    Stall some;
+    Stall full;
+  };
+  using Pressures = std::array<Pressure, kResources>;
+
+  static const char* Name(Resource resource);
+
+  // Read the available pressure files; interval shares cover the elapsed
+  // seconds since the previous read
+  void Read(double elapsed);
+  const Pressures& Values() const;
+
+ private:
+  std::string buffer_ = {};
+  Pressures pressures_ = {};
+  std::array<bool, kResources> missing_ = {};
+};
+
+#endif
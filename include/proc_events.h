@@ -0,0 +1,63 @@
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Process lifecycle events from the kernel proc connector (netlink).
+A background thread subscribes to fork/exec/exit notifications and queues
+them until the next Drain(). Subscribing needs CAP_NET_ADMIN; when it
+fails, or when the socket overflows and events are lost, the caller has to
+fall back to scanning /proc.
+*/
+class ProcEvents {
+ public:
+  // A process that exited, with its CPU time read as it went away
+  struct Exit {
+    int pid;
+    uint64_t startTime;  // 0 if it was already reaped
+    uint64_t activeJiffies;
+  };
+
+  struct Batch {
+    std::vector<int> started;
+    std::vector<int> execed;
+    std::vector<Exit> exited;
+    // Events were dropped since the previous drain
+    bool lost = false;
+  };
+
+  ProcEvents() = default;
+  ~ProcEvents();
+  ProcEvents(const ProcEvents&) = delete;
+  ProcEvents& operator=(const ProcEvents&) = delete;
+
+  // Subscribe and start listening; false if the connector is unavailable
+  bool Start();
+  void Stop();
+  bool Active() const;
+
+  // Move the events received since the previous call into batch, reusing
+  // its storage
+  void Drain(Batch& batch);
+
+ private:
+  void Run();
+  bool Subscribe(bool listen);
+  void Handle(const void* event);
+
+  int socket_ = -1;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> active_{false};
+  std::atomic<bool> delivered_{false};
+
+  std::mutex mutex_;
+  Batch pending_ = {};
+};
+
+#endif
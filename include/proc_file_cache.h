@@ -0,0 +1,120 @@
+#ifndef PROC_FILE_CACHE_H
+#define PROC_FILE_CACHE_H
+
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+Cache of open descriptors for the proc files read on every tick.
+Files are re-read with pread() at offset 0 instead of being reopened.
+Per-PID files are opened with openat() relative to a cached /proc/[pid]
+directory descriptor; a read failing with ESRCH means the process exited
+(or its PID was reused), so its descriptors are dropped and reopened.
+The number of descriptors is bounded by a budget below RLIMIT_NOFILE, and
+the least recently used processes are closed first.
+*/
+class ProcFileCache {
+ public:
+  enum class Global {
+    kStat,
+    kMeminfo,
+    kUptime,
+    kLoadavg,
+    kDiskstats,
+    kNetDev,
+    kPressureCpu,
+    kPressureMemory,
+    kPressureIo,
+    kCount
+  };
+  enum class PidFile { kStat, kStatm, kIo, kCount };
+
+  // Syscalls issued through the cache
+  struct Counters {
+    uint64_t opens;
+    uint64_t reads;
+    uint64_t closes;
+  };
+
+  // budget is the maximum number of descriptors kept open; 0 derives it
+  // from RLIMIT_NOFILE. A budget below the number of shards disables
+  // caching: every read opens and closes the file.
+  explicit ProcFileCache(std::size_t budget = 0);
+  ~ProcFileCache();
+  ProcFileCache(const ProcFileCache&) = delete;
+  ProcFileCache& operator=(const ProcFileCache&) = delete;
+
+  // The cache shared by all parsers
+  static ProcFileCache& Instance();
+  // Raise the soft RLIMIT_NOFILE to the hard limit, so the default budget
+  // is large enough to hold every process; call before Instance() is
+  // first used. Return false if the limit couldn't be raised.
+  static bool RaiseDescriptorLimit();
+
+  // Read a whole file into buffer and NUL-terminate it; return its length
+  // or -1 with errno set on error
+  ssize_t Read(Global file, char* buffer, std::size_t size);
+  bool Read(Global file, std::string& buffer);
+  ssize_t Read(int pid, PidFile file, char* buffer, std::size_t size);
+  // Read a per-PID file that isn't worth keeping open, e.g. "status"
+  ssize_t ReadOnce(int pid, const char* name, char* buffer, std::size_t size);
+
+  // Close everything held for a process that has exited
+  void Evict(int pid);
+
+  // Descriptors the caller keeps itself, e.g. of cgroup files, read and
+  // counted the same way as the cached ones
+  int OpenFile(const char* path);
+  ssize_t ReadFile(int fd, char* buffer, std::size_t size);
+  void CloseFile(int fd);
+
+  std::size_t Budget() const;
+  Counters Count() const;
+
+ private:
+  static constexpr std::size_t kShards = 16;
+  static constexpr std::size_t kPidFiles =
+      static_cast<std::size_t>(PidFile::kCount);
+
+  struct Entry {
+    int dir = -1;
+    std::array<int, kPidFiles> files;
+    std::list<int>::iterator lru;
+  };
+  // PIDs are spread over shards so parallel readers rarely contend
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int, Entry> entries;
+    std::list<int> lru;  // most recently used first
+    std::size_t fds = 0;
+  };
+
+  Shard& ShardOf(int pid);
+  Entry* Lookup(Shard& shard, int pid);
+  void Close(Shard& shard, int pid);
+  void Trim(Shard& shard, int keep);
+  int Open(const char* path, int flags = 0);
+  int OpenAt(int dir, const char* name);
+  void CloseFd(int fd);
+  ssize_t ReadFd(int fd, char* buffer, std::size_t size);
+  ssize_t ReadPath(const char* path, char* buffer, std::size_t size);
+
+  std::size_t budget_;
+  std::array<Shard, kShards> shards_;
+  std::mutex globalMutex_;
+  std::array<int, static_cast<std::size_t>(Global::kCount)> globals_;
+
+  std::atomic<uint64_t> opens_{0};
+  std::atomic<uint64_t> reads_{0};
+  std::atomic<uint64_t> closes_{0};
+};
+
+#endif
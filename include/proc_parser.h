@@ -0,0 +1,82 @@
+#ifndef PROC_PARSER_H
+#define PROC_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Allocation-free parsers for the per-process proc files.
+Each file is read once with read() into a fixed stack buffer and all the
+fields the monitor needs are extracted in a single pass.
+*/
+namespace ProcParser {
+// Longest comm the kernel reports (TASK_COMM_LEN is 16, kernel threads and
+// workqueue names may be longer)
+constexpr std::size_t kCommLength = 64;
+
+// Fields of /proc/[pid]/stat, see proc(5)
+struct Stat {
+  char comm[kCommLength] = {};
+  char state = '?';
+  int ppid = 0;
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  int64_t cutime = 0;
+  int64_t cstime = 0;
+  int64_t numThreads = 0;
+  uint64_t startTime = 0;
+  uint64_t vsize = 0;
+  int64_t rss = 0;
+};
+
+// Fields of /proc/[pid]/status
+struct Status {
+  int uid = -1;
+  uint64_t vmSizeKb = 0;
+  uint64_t vmRssKb = 0;
+};
+
+// Fields of /proc/[pid]/statm, in pages
+struct Statm {
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  uint64_t shared = 0;
+};
+
+// Totals of /proc/[pid]/smaps_rollup. Unlike statm these need a walk of
+// the page tables, but split shared pages fairly (PSS) and include swap.
+struct SmapsRollup {
+  uint64_t rssKb = 0;
+  uint64_t pssKb = 0;
+  uint64_t swapKb = 0;
+};
+
+// Fields of /proc/[pid]/io: bytes the process caused to be fetched from
+// and sent to storage
+struct Io {
+  uint64_t readBytes = 0;
+  uint64_t writeBytes = 0;
+  uint64_t cancelledWriteBytes = 0;
+};
+
+bool ParseStat(const char* buffer, std::size_t size, Stat& stat);
+bool ParseStatus(const char* buffer, std::size_t size, Status& status);
+bool ParseStatm(const char* buffer, std::size_t size, Statm& statm);
+bool ParseSmapsRollup(const char* buffer, std::size_t size,
+                      SmapsRollup& rollup);
+bool ParseIo(const char* buffer, std::size_t size, Io& io);
+
+bool ReadStat(int pid, Stat& stat);
+// The same without keeping the file open, for processes about to go away
+bool ReadStatOnce(int pid, Stat& stat);
+bool ReadStatus(int pid, Status& status);
+bool ReadStatm(int pid, Statm& statm);
+// /proc/[pid]/task/[tid]/stat, the same fields for a single thread
+bool ReadTaskStat(int pid, int tid, Stat& stat);
+bool ReadSmapsRollup(int pid, SmapsRollup& rollup);
+// Only readable for processes we could ptrace, i.e. our own without root.
+// On failure error, if given, is set to the errno of the read, e.g. EACCES.
+bool ReadIo(int pid, Io& io, int* error = nullptr);
+};  // namespace ProcParser
+
+#endif
@@ -1,27 +1,60 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+
+class ProcessTable;
+
 /*
-Basic class for Process representation
-It contains relevant attributes as shown below
+A view of one process in a ProcessTable. It is cheap to copy and holds
+no data of its own, so it is only valid while the row it refers to is.
 */
 class Process {
  public:
-  explicit Process(int pid);
+  // Memory use in kB. rssKb is refreshed from stat on every tick, so all
+  // processes can be ranked by it; sharedKb comes from statm for displayed
+  // rows. pssKb and swapKb are only measured with accurate memory, which
+  // sets accurate.
+  struct Memory {
+    uint64_t rssKb = 0;
+    uint64_t sharedKb = 0;
+    uint64_t pssKb = 0;
+    uint64_t swapKb = 0;
+    bool accurate = false;
+  };
+
+  // Storage I/O in bytes per second. known is false until /proc/[pid]/io
+  // was read on two ticks, and for processes whose io file we may not read.
+  struct Io {
+    float readRate = 0.0;
+    float writeRate = 0.0;
+    bool known = false;
+  };
+
+  Process(const ProcessTable& table, std::size_t row);
 
   int Pid() const;
-  std::string User() const;
-  std::string Command() const;
+  int ParentPid() const;
+  // -1 until the details are loaded
+  int Uid() const;
+  uint64_t StartTime() const;
+  // NUL-terminated, empty until the details are loaded
+  const char* User() const;
+  const char* Command() const;
   float CpuUtilization() const;
-  std::string Ram() const;
+  Memory Ram() const;
+  // num_threads of the last sample
+  int64_t ThreadCount() const;
+  Io DiskIo() const;
   long int UpTime() const;
-  bool operator<(Process const& a) const;
-
-  float cpuUtilization_;
+  uint64_t LastSeen() const;
+  // Jiffies used up to the last sample
+  uint64_t ActiveJiffies() const;
 
  private:
-  int pid_;
+  const ProcessTable* table_;
+  std::size_t row_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#ifndef PROCESS_FILTER_H
+#define PROCESS_FILTER_H
+
+#include <regex.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+A process filter compiled once from the text the user entered.
+The text is a list of space-separated terms that must all match:
+"user:NAME" matches the user name exactly, "re:REGEX" searches the
+command line for an extended regular expression, and any other term is a
+case-insensitive substring of the command line. Matching allocates
+nothing, and compiled filters are immutable, so copies share their
+regular expressions and may be used from any thread.
+*/
+class ProcessFilter {
+ public:
+  // Replace the filter with text; on a malformed regular expression leave
+  // it unchanged, set error and return false
+  bool Compile(const std::string& text, std::string* error = nullptr);
+  // True if the filter lets every process through
+  bool Empty() const;
+  const std::string& Text() const;
+  bool Matches(const char* user, const char* command) const;
+
+ private:
+  std::string text_ = {};
+  std::vector<std::string> users_ = {};
+  std::vector<std::string> substrings_ = {};
+  std::vector<std::shared_ptr<const regex_t>> patterns_ = {};
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "host_info.h"
+#include "proc_parser.h"
+#include "process.h"
+#include "process_filter.h"
+#include "string_pool.h"
+
+/*
+Processes stored as columns: one contiguous array per field, all indexed
+by row, so ranking a tick streams through the few columns it compares.
+Command lines and user names are interned in a StringPool and referenced
+by id, which makes a row a fixed number of bytes plus its share of the
+distinct strings. Rows are found by pid through an open-addressing index
+and removed by moving the last row into the gap, so a row number only
+holds until the next Remove(). Process is a view of one row.
+*/
+class ProcessTable {
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+  // Rank of a row that wasn't in the last ranking
+  static constexpr uint32_t kUnranked = UINT32_MAX;
+
+  // Yields a Process view per row
+  class Iterator {
+   public:
+    Iterator(const ProcessTable& table, std::size_t row)
+        : table_(&table), row_(row) {}
+    Process operator*() const { return Process(*table_, row_); }
+    Iterator& operator++() {
+      ++row_;
+      return *this;
+    }
+    bool operator==(const Iterator& other) const { return row_ == other.row_; }
+    bool operator!=(const Iterator& other) const { return row_ != other.row_; }
+
+   private:
+    const ProcessTable* table_;
+    std::size_t row_;
+  };
+
+  ProcessTable();
+
+  std::size_t size() const;
+  bool empty() const;
+  Process operator[](std::size_t row) const;
+  Iterator begin() const;
+  Iterator end() const;
+
+  // Row of pid, or npos
+  std::size_t Find(int pid) const;
+  // Append a row for a pid that isn't in the table and return it
+  std::size_t Add(int pid, uint64_t startTime);
+  // Start row over for a new process that reused its pid
+  void Reset(std::size_t row, uint64_t startTime);
+  // Drop row; the last row takes its place
+  void Remove(std::size_t row);
+  void Clear();
+  // Append a copy of row of table, with its strings interned here
+  void Append(const ProcessTable& table, std::size_t row);
+  // Append a process restored from recorded history, with all fields fixed
+  void Append(int pid, float cpuUtilization, std::string_view user,
+              std::string_view command, const Process::Memory& ram,
+              const Process::Io& io, long upTime);
+
+  // Record the per-tick fields of a /proc/[pid]/stat reading; totalDelta is
+  // the system-wide jiffies elapsed since the previous tick (0 on the very
+  // first tick). A changed comm means the process exec'd and drops the
+  // cached command and user.
+  void Sample(std::size_t row, const ProcParser::Stat& stat,
+              uint64_t totalDelta, long uptime, uint64_t tick,
+              const HostInfo& host);
+  // Load the command and user, once per process image
+  void LoadIdentity(std::size_t row);
+  // Load the fields only needed for displayed rows: the identity, statm on
+  // every call, and smaps_rollup every few ticks when accurate is set
+  void LoadDetails(std::size_t row, long uptime, const HostInfo& host,
+                   bool accurate);
+  // Forget the cached command and user, e.g. after an exec
+  void InvalidateDetails(std::size_t row);
+  // Whether row passes filter, loading its identity if needed. The result
+  // is kept until the process execs, so filter must stay the same until
+  // the next ResetMatches().
+  bool Matches(std::size_t row, const ProcessFilter& filter);
+  void ResetMatches();
+  // Position of row in the last ranking, see System::Processes()
+  uint32_t LastRank(std::size_t row) const;
+  void SetRank(std::size_t row, uint32_t rank);
+  // True if the process may have done I/O during the last tick: it used
+  // CPU or sleeps uninterruptibly. Processes that didn't run can't have
+  // issued any, so their io file isn't read and their rates are 0.
+  bool IoCandidate(std::size_t row) const;
+  // Read /proc/[pid]/io, at most once per tick, and update the rates over
+  // the seconds since the row's previous read, which may be several ticks
+  // ago; uptime is the system uptime of this tick. Distinct rows may be
+  // sampled from several threads at once.
+  void SampleIo(std::size_t row, double uptime);
+
+  // Heap bytes held by the columns, the index and the strings
+  std::size_t Bytes() const;
+
+ private:
+  friend class Process;
+
+  // Values of match_
+  enum Match : uint8_t { kMatchUnknown, kMatched, kFiltered };
+
+  // Bits of flags_
+  enum Flag : uint8_t {
+    kSampled = 1,
+    kBusy = 2,
+    kDetailsLoaded = 4,
+    kIoKnown = 8,
+    kIoDenied = 16,
+    kAccurate = 32,
+  };
+
+  // Call fn with a pointer to each column member
+  template <typename Fn>
+  static void Columns(Fn fn);
+  std::size_t Slot(int pid) const;
+  void Unindex(int pid);
+  void Rehash(std::size_t slots);
+
+  std::vector<int32_t> pid_ = {};
+  std::vector<int32_t> ppid_ = {};
+  std::vector<int32_t> uid_ = {};
+  std::vector<char> state_ = {};
+  std::vector<uint8_t> flags_ = {};
+  std::vector<int32_t> threads_ = {};
+  std::vector<uint64_t> startTime_ = {};
+  // Jiffies used up to the last sample and the tick it was taken in
+  std::vector<uint64_t> jiffies_ = {};
+  std::vector<uint64_t> lastSeen_ = {};
+  // FNV-1a of comm, enough to notice that it changed
+  std::vector<uint32_t> commHash_ = {};
+  std::vector<float> cpu_ = {};
+  std::vector<uint64_t> rssKb_ = {};
+  std::vector<uint64_t> sharedKb_ = {};
+  std::vector<uint64_t> pssKb_ = {};
+  std::vector<uint64_t> swapKb_ = {};
+  std::vector<uint64_t> rollupTick_ = {};
+  std::vector<float> readRate_ = {};
+  std::vector<float> writeRate_ = {};
+  // Counters of the last io read, in the tick and at the uptime it was made
+  std::vector<uint64_t> ioTick_ = {};
+  std::vector<double> ioUptime_ = {};
+  std::vector<uint64_t> ioRead_ = {};
+  std::vector<uint64_t> ioWritten_ = {};
+  std::vector<int64_t> upTime_ = {};
+  // Ids in strings_
+  std::vector<uint32_t> command_ = {};
+  std::vector<uint32_t> user_ = {};
+  std::vector<uint8_t> match_ = {};
+  std::vector<uint32_t> rank_ = {};
+
+  StringPool strings_ = {};
+  // Open addressing from pid to row + 1 with linear probing; 0 marks an
+  // empty slot. Never more than half full.
+  std::vector<uint32_t> slots_ = {};
+};
+
+#endif
@@ -1,16 +1,33 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
+#include <vector>
+
 #include "linux_parser.h"
+#include "system_snapshot.h"
 
 class Processor {
  public:
-  Processor();
-  float Utilization();
+  // Utilization reported for CPUs that are offline or have no valid
+  // interval yet
+  static constexpr float kOffline = -1.0f;
+
+  // Compute the utilization over the interval since the previous snapshot
+  void Update(const SystemSnapshot& snapshot);
+  float Utilization() const;
+  // Per-core utilization, indexed by CPU number
+  const std::vector<float>& CoreUtilization() const;
 
  private:
-  uint64_t prev_user, prev_nice, prev_system, prev_idle, prev_iowait, prev_irq,
-      prev_softirq, prev_steal;
+  // Totals per slot (slot 0 is the aggregate, N + 1 is cpuN)
+  std::vector<uint64_t> prevTotal_ = {};
+  std::vector<uint64_t> prevIdle_ = {};
+  std::vector<uint8_t> prevPresent_ = {};
+  std::vector<uint64_t> total_ = {};
+  std::vector<uint64_t> idle_ = {};
+  std::vector<float> utilization_ = {};
+  std::vector<float> cores_ = {};
+  float aggregate_ = 0.0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,91 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "history_file.h"
+#include "snapshot.h"
+#include "stall_triggers.h"
+#include "system.h"
+#include "triple_buffer.h"
+
+/*
+Background thread that collects a Snapshot from System every period and
+publishes it through a triple buffer, so a renderer can always read the
+latest complete snapshot without blocking on collection.
+When a collection takes more than a quarter of the period, the period is
+stretched so the monitor never spends more than that share of a CPU on
+itself. Every publication is signalled on an eventfd a renderer can poll.
+With stall triggers armed, a snapshot is also collected as soon as the
+kernel reports a CPU, memory or I/O stall.
+*/
+class Sampler {
+ public:
+  // rows is the number of processes each snapshot carries; every snapshot
+  // is also appended to history when given
+  Sampler(System& system, std::size_t rows, std::chrono::milliseconds period,
+          HistoryFile* history = nullptr);
+  ~Sampler();
+  Sampler(const Sampler&) = delete;
+  Sampler& operator=(const Sampler&) = delete;
+
+  void Start();
+  void Stop();
+  // Only one thread may read snapshots; the reference stays valid until the
+  // next call
+  const Snapshot& Latest();
+  // Readable after each publication; read it to reset
+  int NotifyFd() const;
+  // Snapshots the history file couldn't take, e.g. for being larger than
+  // the whole file
+  uint64_t Unrecorded() const;
+  // Rank the processes of the following snapshots by key
+  void SortBy(System::SortKey key);
+  // Only carry processes that pass filter in the following snapshots
+  void FilterBy(ProcessFilter filter);
+  // Include the threads of these processes in the following snapshots
+  void Expand(std::vector<int> pids);
+  // Group the following snapshots by cgroup, with the members of the
+  // expanded groups, see System::GroupByCgroup()
+  void GroupByCgroup(bool enabled, std::vector<int> expanded = {});
+  // Collect right away when tasks stall on a resource for threshold within
+  // StallTriggers::kWindow; call before Start(). Return false if no trigger
+  // could be armed.
+  bool WakeOnStall(std::chrono::microseconds threshold);
+
+ private:
+  void Run();
+  void Publish();
+  void Collect(Snapshot& snapshot, bool stalled = false);
+
+  System& system_;
+  const std::size_t rows_;
+  const std::chrono::milliseconds period_;
+  HistoryFile* const history_;
+  TripleBuffer<Snapshot> buffers_;
+  uint64_t tick_ = 0;
+  std::atomic<uint64_t> unrecorded_{0};
+  int notify_ = -1;
+  // Wakes the sampling thread to stop
+  int wakeup_ = -1;
+  StallTriggers triggers_ = {};
+  std::atomic<System::SortKey> sortKey_{System::SortKey::kCpu};
+  // Handed to System by the sampling thread, guarded by mutex_
+  std::vector<int> expand_ = {};
+  bool expandChanged_ = false;
+  bool grouped_ = false;
+  std::vector<int> expandGroups_ = {};
+  bool groupsChanged_ = false;
+  ProcessFilter filter_ = {};
+  bool filterChanged_ = false;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::atomic<bool> stop_{false};
+};
+
+#endif
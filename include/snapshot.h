@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cgroup_table.h"
+#include "disk_stats.h"
+#include "instrument.h"
+#include "net_stats.h"
+#include "pressure_stats.h"
+#include "process_table.h"
+#include "system.h"
+#include "task_table.h"
+
+/*
+Everything the display needs for one frame, collected in one go by the
+sampler so the renderer never touches /proc for system-wide values
+*/
+struct Snapshot {
+  // Refresh system and fill this snapshot in place, reusing its storage;
+  // rows is the number of processes to carry, ranked by key
+  void Collect(System& system, std::size_t rows,
+               System::SortKey key = System::SortKey::kCpu);
+
+  uint64_t tick = 0;
+  // Wall clock time of the sample, in milliseconds since the epoch
+  int64_t time = 0;
+  std::string operatingSystem;
+  std::string kernel;
+  float cpuUtilization = 0.0;
+  // Indexed by CPU number, Processor::kOffline for CPUs without data
+  std::vector<float> coreUtilization;
+  float memoryUtilization = 0.0;
+  float swapUtilization = 0.0;
+  int totalProcesses = 0;
+  int runningProcesses = 0;
+  int blockedProcesses = 0;
+  // Load averages over 1, 5 and 15 minutes
+  float loadAverage[3] = {};
+  // Stall pressure, see PressureStats
+  PressureStats::Pressures pressure = {};
+  // Collected ahead of its tick because a PSI trigger fired
+  bool stallTriggered = false;
+  // Processes that exited during the tick, when process events are on
+  bool processEvents = false;
+  int exitedProcesses = 0;
+  int shortLivedProcesses = 0;
+  float exitedCpuUtilization = 0.0;
+  // Block devices that have done any I/O, with rates over the tick
+  std::vector<DiskStats::Device> disks;
+  // Network interfaces that moved traffic, busiest first
+  std::vector<NetStats::Interface> interfaces;
+  // Cumulative counters since boot
+  uint64_t contextSwitches = 0;
+  uint64_t interrupts = 0;
+  long upTime = 0;
+  // The first processes in the order of sortKey, see System::SortKey
+  System::SortKey sortKey = System::SortKey::kCpu;
+  ProcessTable processes;
+  // Text of the process filter, empty for none, and how many processes
+  // passed it
+  std::string filter;
+  std::size_t matchingProcesses = 0;
+  // Processes grouped by cgroup v2, see System::GroupByCgroup(); processes
+  // then only holds members of expanded groups
+  bool grouped = false;
+  bool cgroupsAvailable = false;
+  std::vector<CgroupTable::Group> groups;
+  // Threads of the expanded processes, see System::Threads()
+  std::vector<TaskTable::Thread> threads;
+  // The monitor's own cost, empty when instrumentation is compiled out
+  std::vector<Instrument::PhaseStats> phases;
+};
+
+#endif
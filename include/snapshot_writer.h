@@ -0,0 +1,78 @@
+#ifndef SNAPSHOT_WRITER_H
+#define SNAPSHOT_WRITER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "options.h"
+#include "snapshot.h"
+
+/*
+Serializes snapshots to a file descriptor, either as one JSON object per
+line (NDJSON) or as length-prefixed binary records. Records are appended to
+an in-memory buffer and written out in batches once it is large enough or
+has been held for long enough.
+
+Binary stream, all integers and floats in native (little-endian) byte
+order:
+  header:  "SMON" u16 version
+  record:  u32 length of what follows, then
+           u64 tick, i64 time_ms, f32 cpu, f32 memory, f32 swap,
+           u32 total, u32 running, u32 blocked, i64 uptime_s,
+           u64 context_switches, u64 interrupts,
+           u16 cores, f32 core_cpu[cores],
+           f32 load[3], u8 stall_triggered,
+           for cpu, memory and io: u8 available, then for some and full:
+             f32 avg10, f32 avg60, f32 interval, u64 total_us
+             (fractions of wall time, all 0 unless available)
+           u16 disks, then per disk:
+             u16 name_length, name, f32 read_bps, f32 write_bps, f32 iops,
+             f32 utilization
+           u16 interfaces, then per network interface:
+             u16 name_length, name, f32 rx_bps, f32 tx_bps, f32 rx_pps,
+             f32 tx_pps, f32 errors_per_s, f32 drops_per_s
+           u8 grouped, u32 groups (cgroups, 0 unless grouped), then per
+           group:
+             i32 id, u16 path_length, path, u32 processes, u8 known
+             (1 memory, 2 io, 4 cpu stall), f32 cpu, f32 cpu_stall,
+             u64 memory_bytes, f32 read_bps, f32 write_bps
+           u32 processes (members of expanded groups when grouped), then
+           per process:
+             i32 pid, f32 cpu, u64 rss_kb, u64 shared_kb,
+             u64 pss_kb, u64 swap_kb (both 0 unless measured),
+             f32 read_bps, f32 write_bps (both -1 if unknown), i64 uptime_s,
+             u16 user_length, user, u16 command_length, command
+           u32 threads (of expanded processes), then per thread:
+             i32 pid, i32 tid, u8 state, f32 cpu, u16 name_length, name
+           u8 phases (0 without instrumentation), then per phase:
+             u8 phase, u64 calls, u64 last_us, u64 p50_us, u64 p99_us,
+             u64 syscalls, u64 bytes, u64 allocations, u64 processes
+             (the counters of the last call)
+*/
+class SnapshotWriter {
+ public:
+  static constexpr uint16_t kBinaryVersion = 8;
+
+  SnapshotWriter(int fd, Options::Format format);
+  ~SnapshotWriter();
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  // Buffer a snapshot, writing out the batch when due; false on an I/O
+  // error
+  bool Write(const Snapshot& snapshot);
+  // Write out everything buffered; false on an I/O error
+  bool Flush();
+
+ private:
+  void AppendJson(const Snapshot& snapshot);
+  void AppendBinary(const Snapshot& snapshot);
+
+  const int fd_;
+  const Options::Format format_;
+  std::string buffer_;
+  std::chrono::steady_clock::time_point lastFlush_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef STALL_TRIGGERS_H
+#define STALL_TRIGGERS_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/*
+PSI triggers on /proc/pressure/{cpu,memory,io}: the kernel raises POLLPRI
+on a trigger descriptor when tasks stalled on the resource for longer than
+a threshold within a window, at most once per window. Waiting on them lets
+a collector wake up as soon as a stall starts instead of at its next tick.
+Without PSI, or without permission to create triggers, none are open and
+Wait() is a plain sleep.
+*/
+class StallTriggers {
+ public:
+  // Window the threshold applies to; unprivileged triggers need a multiple
+  // of two seconds
+  static constexpr std::chrono::seconds kWindow{2};
+
+  StallTriggers() = default;
+  ~StallTriggers();
+  StallTriggers(const StallTriggers&) = delete;
+  StallTriggers& operator=(const StallTriggers&) = delete;
+
+  // Arm a "some" trigger on every resource; return how many were armed
+  std::size_t Open(std::chrono::microseconds threshold);
+  void Close();
+  bool Active() const;
+
+  // Sleep until deadline, until wake (an eventfd, if not -1) is readable or
+  // until a trigger fires; return true for a trigger
+  bool Wait(std::chrono::steady_clock::time_point deadline, int wake = -1);
+
+ private:
+  std::vector<int> fds_ = {};
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+Interned strings in one character arena, referenced by 32-bit id.
+Equal strings share an id and their bytes; an id stays valid until its
+last reference is released. Dead bytes are reclaimed by compacting the
+arena once they make up most of it, so the footprint follows the live
+strings rather than everything ever interned. Id 0 is the empty string
+and is never counted.
+*/
+class StringPool {
+ public:
+  StringPool();
+
+  // Return the id of text, adding it if it is new, and take a reference
+  uint32_t Intern(std::string_view text);
+  // Take another reference to id
+  void Retain(uint32_t id);
+  void Release(uint32_t id);
+  // NUL-terminated; valid until the next Intern()
+  const char* Get(uint32_t id) const;
+  // Drop every string at once, keeping the storage
+  void Clear();
+  // Heap bytes held by the arena and its index
+  std::size_t Bytes() const;
+
+ private:
+  struct Entry {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t refs;
+    uint32_t hash;
+  };
+
+  // Slot of text in slots_, or of the empty slot where it would go
+  std::size_t Slot(std::string_view text, uint32_t hash) const;
+  void Unlink(uint32_t id);
+  void Rehash(std::size_t slots);
+  void Compact();
+
+  std::vector<char> chars_ = {};
+  std::vector<Entry> entries_ = {};
+  // Ids of released entries, reused first
+  std::vector<uint32_t> free_ = {};
+  // Open addressing over entry ids with linear probing; 0 marks an empty
+  // slot. Never more than half full.
+  std::vector<uint32_t> slots_ = {};
+  std::size_t live_ = 0;
+  std::size_t deadBytes_ = 0;
+};
+
+#endif
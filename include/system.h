@@ -3,35 +3,171 @@
 
 #include <atomic>
 #include <chrono>
+#include <limits>
 #include <mutex>
 #include <string>
-#include <vector>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "cgroup_table.h"
+#include "disk_stats.h"
+#include "host_info.h"
+#include "net_stats.h"
+#include "pid_enumerator.h"
+#include "proc_events.h"
+#include "proc_parser.h"
+#include "pressure_stats.h"
 #include "process.h"
+#include "process_filter.h"
+#include "process_table.h"
 #include "processor.h"
+#include "system_snapshot.h"
+#include "task_table.h"
+#include "worker_pool.h"
 
 class System {
  public:
-  System();
+  // Order of the processes returned by Processes(): descending CPU,
+  // resident memory or storage I/O, ascending pid, or oldest first
+  enum class SortKey { kCpu, kMemory, kIo, kPid, kTime };
+
+  // Processes that exited during the last tick, as reported by process
+  // events. Short-lived ones started after the previous tick and were
+  // never seen by it.
+  struct Exits {
+    int exited = 0;
+    int shortLived = 0;
+    // Share of the tick's CPU time used by them since their last sample
+    float cpuUtilization = 0.0;
+  };
+
+  // threads is the size of the /proc collection pool; 0 picks one per
+  // hardware thread and 1 collects on the calling thread only.
+  // processEvents tracks process creation and exit through the kernel proc
+  // connector when it is available, instead of rescanning /proc each tick.
+  explicit System(std::size_t threads = 0, bool processEvents = true);
   ~System() = default;
 
+  // Read the global proc files once for the next tick; everything below
+  // works on this snapshot. Host facts are re-read every
+  // HostInfo::kRefreshInterval refreshes.
+  void Refresh();
+  const SystemSnapshot& Snapshot() const;
+  // Block devices with their rates over the last tick
+  const std::vector<DiskStats::Device>& Disks() const;
+  // Network interfaces that moved traffic during the last tick, busiest
+  // first
+  const std::vector<NetStats::Interface>& Interfaces() const;
+  // Stall pressure of the CPU, memory and I/O over the last tick
+  const PressureStats::Pressures& Pressure() const;
+
   Processor& Cpu();
-  std::vector<Process>& Processes();
-  static float MemoryUtilization();
-  static long UpTime();
-  static int TotalProcesses();
-  static int RunningProcesses();
+  // The rows processes with the highest CPU utilization, resident memory
+  // or storage I/O, in descending order and with their display fields
+  // loaded
+  const ProcessTable& Processes(
+      std::size_t rows = std::numeric_limits<std::size_t>::max(),
+      SortKey key = SortKey::kCpu);
+  // Every tracked process as of the last Processes() call, in no order
+  const ProcessTable& Table() const;
+  // Only rank processes that pass filter. A process is matched once per
+  // process image, before any of its display fields are loaded.
+  void FilterBy(ProcessFilter filter);
+  const ProcessFilter& Filter() const;
+  // Processes that passed the filter in the last Processes() call
+  std::size_t MatchingProcesses() const;
+  // Measure PSS and swap of the returned processes through smaps_rollup
+  void AccurateMemory(bool enabled);
+  // Collect the threads of these processes on the following ticks
+  void Expand(std::vector<int> pids);
+  const std::vector<int>& Expanded() const;
+  // Threads of the expanded processes from the last Processes() call,
+  // grouped by process and by descending CPU utilization within each
+  const std::vector<TaskTable::Thread>& Threads() const;
+  // Group processes by cgroup v2. Processes() then only samples the
+  // members of the expanded groups, so /proc/[pid]/stat isn't read for
+  // every process, and Groups() holds the totals of all groups.
+  void GroupByCgroup(bool enabled, std::vector<int> expanded = {});
+  bool Grouped() const;
+  // False without a cgroup2 hierarchy to group by
+  bool CgroupsAvailable() const;
+  // Groups with processes as of the last Processes() call, in the order of
+  // its sort key
+  const std::vector<CgroupTable::Group>& Groups() const;
+  float MemoryUtilization() const;
+  float SwapUtilization() const;
+  long UpTime() const;
+  int TotalProcesses() const;
+  int RunningProcesses() const;
+  int BlockedProcesses() const;
+  bool ProcessEvents() const;
+  const Exits& RecentExits() const;
   std::string Kernel() const;
   std::string OperatingSystem() const;
 
  private:
-  std::mutex dataMutex_;
+  void AccountExits(uint64_t totalDelta);
+  void RankProcesses(SortKey key);
+  void UpdateThreads(uint64_t totalDelta);
 
+  SystemSnapshot snapshot_ = {};
+  uint64_t prevJiffies_ = 0;
+  uint64_t jiffiesDelta_ = 0;
+  // Seconds between the last two snapshots
+  double prevUptime_ = 0;
+  double elapsed_ = 0;
+  DiskStats disks_ = {};
+  NetStats net_ = {};
+  PressureStats pressure_ = {};
   Processor cpu_ = {};
-  std::vector<Process> processes_ = {};
-  const std::string kernel_;
-  const std::string operatingSystem_;
+  HostInfo host_ = {};
+  unsigned hostAge_ = 0;
+  bool accurateMemory_ = false;
+
+  // Persistent process table; rows survive across ticks so CPU usage can
+  // be computed from deltas
+  ProcessTable table_ = {};
+  // Sort key of a row, copied out so ranking doesn't chase rows
+  struct Rank {
+    double key;
+    float cpu;
+    uint32_t row;
+  };
+  // Every matching row, in the order of the last ranking; each row's
+  // position is kept in the table so the next tick can start from it
+  std::vector<Rank> ranking_ = {};
+  std::vector<Rank> unranked_ = {};
+  SortKey rankedBy_ = SortKey::kCpu;
+  bool resort_ = true;
+  ProcessFilter filter_ = {};
+  std::vector<uint32_t> ioCandidates_ = {};
+  // The rows returned by Processes(), with their own strings
+  ProcessTable processes_ = {};
+  uint64_t tick_ = 0;
+
+  // Per-worker slices of parsed /proc/[pid]/stat records, reused every tick
+  struct Sample {
+    int pid;
+    ProcParser::Stat stat;
+  };
+  WorkerPool pool_;
+  std::vector<std::vector<Sample>> samples_ = {};
+  PidEnumerator pidEnumerator_;
+  std::vector<int> pids_ = {};
+
+  std::vector<int> expanded_ = {};
+  std::unordered_map<int, TaskTable> tasks_ = {};
+  std::vector<TaskTable::Thread> threads_ = {};
+
+  bool grouped_ = false;
+  std::vector<int> expandedGroups_ = {};
+  CgroupTable cgroups_ = {};
+
+  ProcEvents events_;
+  ProcEvents::Batch batch_ = {};
+  uint64_t lastScan_ = 0;
+  Exits exits_ = {};
 };
 
 #endif
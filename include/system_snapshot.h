@@ -0,0 +1,65 @@
+#ifndef SYSTEM_SNAPSHOT_H
+#define SYSTEM_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+
+#include "linux_parser.h"
+
+/*
+One consistent reading of the global proc files (/proc/stat, /proc/meminfo,
+/proc/uptime and /proc/loadavg). Each file is read exactly once per Read()
+and every line is matched against a keyed table, so the order of lines
+doesn't matter.
+The same snapshot is shared by System, Processor and the per-process
+calculations of a tick.
+*/
+class SystemSnapshot {
+ public:
+  bool Read();
+
+  // Total jiffies of the aggregate CPU line
+  uint64_t Jiffies() const;
+  float MemoryUtilization() const;
+  float SwapUtilization() const;
+
+  // /proc/stat
+  LinuxParser::CpuTimes cpu = {};
+  uint64_t interrupts = 0;
+  uint64_t contextSwitches = 0;
+  uint64_t bootTime = 0;
+  uint64_t forks = 0;
+  uint64_t procsRunning = 0;
+  uint64_t procsBlocked = 0;
+
+  // /proc/meminfo, in kB
+  uint64_t memTotal = 0;
+  uint64_t memFree = 0;
+  uint64_t memAvailable = 0;
+  uint64_t buffers = 0;
+  uint64_t cached = 0;
+  uint64_t swapTotal = 0;
+  uint64_t swapFree = 0;
+  bool hasMemAvailable = false;
+
+  // /proc/uptime, in seconds
+  double uptime = 0;
+  double idleTime = 0;
+
+  // /proc/loadavg: runnable and uninterruptible tasks averaged over 1, 5
+  // and 15 minutes
+  float load1 = 0;
+  float load5 = 0;
+  float load15 = 0;
+
+ private:
+  bool ReadStat();
+  bool ReadMeminfo();
+  bool ReadUptime();
+  bool ReadLoadavg();
+
+  // Reused between reads; /proc/stat can be tens of KB on large machines
+  std::string buffer_ = {};
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TASK_TABLE_H
+#define TASK_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pid_enumerator.h"
+#include "process.h"
+
+/*
+The threads of one process, from /proc/[pid]/task, sampled like processes
+so per-thread CPU utilization comes from deltas. Scanning is incremental:
+the task directory is only listed again when the process's num_threads
+changes or a thread has vanished, and on ticks where the process used no
+CPU at all its threads' stat files aren't read either, since none of them
+can have run. Only expanded processes get a table, so the cost is
+proportional to the threads being looked at, not to the host.
+*/
+class TaskTable {
+ public:
+  struct Thread {
+    int pid = 0;
+    int tid = 0;
+    char state = '?';
+    // TASK_COMM_LEN
+    char name[16] = {};
+    float cpuUtilization = 0.0;
+  };
+
+  TaskTable(int pid, uint64_t startTime);
+  TaskTable(const TaskTable&) = delete;
+  TaskTable& operator=(const TaskTable&) = delete;
+
+  // Start time of the process, telling a reused pid apart
+  uint64_t StartTime() const;
+  // Sample the threads after process was sampled for the tick; totalDelta
+  // is the system-wide jiffies elapsed since the previous tick
+  void Update(const Process& process, uint64_t totalDelta);
+  // Live threads by descending CPU utilization
+  const std::vector<Thread>& Threads() const;
+
+ private:
+  void List();
+
+  const int pid_;
+  const uint64_t startTime_;
+  PidEnumerator enumerator_;
+  // num_threads when the directory was last listed, -1 to list again
+  int64_t listed_ = -1;
+  std::vector<int> tids_ = {};
+  // By tid, in step with the parallel arrays below
+  std::vector<Thread> threads_ = {};
+  std::vector<uint64_t> jiffies_ = {};
+  std::vector<uint8_t> sampled_ = {};
+  std::vector<Thread> ranked_ = {};
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/*
+Lock-free single-producer/single-consumer buffer exchange.
+The producer fills Back() and Publish()es it; the consumer's Front() always
+returns the most recently published value, which stays valid (and is never
+written to) until the consumer calls Front() again. The three slots are
+reused, so publishing allocates nothing once they have grown.
+*/
+template <typename T>
+class TripleBuffer {
+ public:
+  // Producer: the slot to fill next
+  T& Back() { return buffers_[back_]; }
+
+  // Producer: make Back() the latest value and get a fresh slot to fill
+  void Publish() {
+    back_ = ready_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndex;
+  }
+
+  // Consumer: the latest published value
+  const T& Front() {
+    if (ready_.load(std::memory_order_relaxed) & kFresh) {
+      front_ = ready_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    }
+    return buffers_[front_];
+  }
+
+ private:
+  static constexpr int kIndex = 0x3;
+  static constexpr int kFresh = 0x4;
+
+  T buffers_[3] = {};
+  int back_ = 0;
+  int front_ = 1;
+  std::atomic<int> ready_{2};
+};
+
+#endif
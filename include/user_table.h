@@ -0,0 +1,38 @@
+#ifndef USER_TABLE_H
+#define USER_TABLE_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+UID to username table built from the password file.
+The file is parsed once into a hash map and only reloaded when its inode,
+size or modification time changes.
+*/
+class UserTable {
+ public:
+  explicit UserTable(std::string path);
+
+  std::string Name(int uid);
+
+ private:
+  bool Changed(const struct stat& st) const;
+  bool Reload();
+
+  std::mutex mutex_;
+  const std::string path_;
+  std::unordered_map<int, std::string> names_ = {};
+  dev_t device_ = 0;
+  ino_t inode_ = 0;
+  off_t size_ = 0;
+  timespec mtime_ = {};
+  std::chrono::steady_clock::time_point lastCheck_ = {};
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "instrument.h"
+
+/*
+Fixed-size pool of worker threads for data-parallel loops.
+The calling thread takes part as worker 0, so a pool of size 1 runs
+everything inline without any synchronisation.
+*/
+class WorkerPool {
+ public:
+  // fn(begin, end, worker) processes the index range [begin, end)
+  using Task = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+  // threads == 0 picks one per hardware thread
+  explicit WorkerPool(std::size_t threads = 0);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  std::size_t Size() const;
+  void ParallelFor(std::size_t count, std::size_t chunk, const Task& task);
+
+ private:
+  void Run(std::size_t worker);
+  void Work(std::size_t worker);
+
+  std::vector<std::thread> threads_ = {};
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  std::size_t pending_ = 0;
+  bool stop_ = false;
+
+  // State of the loop currently being run
+  const Task* task_ = nullptr;
+  std::size_t count_ = 0;
+  std::size_t chunk_ = 1;
+  std::atomic<std::size_t> next_{0};
+#if MONITOR_INSTRUMENT
+  Instrument::Phase phase_ = Instrument::Phase::kNone;
+#endif
+};
+
+#endif
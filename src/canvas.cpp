@@ -0,0 +1,113 @@
+#include "canvas.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// Segment header in a composed row: u16 column, u8 pair, u16 length
+constexpr std::size_t kHeaderSize = 5;
+}  // namespace
+
+Canvas::~Canvas() { Destroy(); }
+
+void Canvas::Create(int height, int width, int y, int x, bool border) {
+  Destroy();
+  inset_ = border ? 1 : 0;
+  height = std::min(height, LINES - y);
+  width = std::min(width, COLS - x);
+  if (height < 1 + 2 * inset_ || width < 1 + 2 * inset_) return;
+  window_ = newwin(height, width, y, x);
+  if (window_ == nullptr) return;
+  leaveok(window_, true);
+  if (border) box(window_, 0, 0);
+  shadow_.assign(height, {});
+}
+
+void Canvas::Destroy() {
+  if (window_ == nullptr) return;
+  // Leave blank space behind for the next doupdate()
+  werase(window_);
+  wnoutrefresh(window_);
+  delwin(window_);
+  window_ = nullptr;
+  shadow_.clear();
+}
+
+bool Canvas::Valid() const { return window_ != nullptr; }
+
+int Canvas::Height() const { return window_ ? getmaxy(window_) : 0; }
+
+int Canvas::Width() const { return window_ ? getmaxx(window_) : 0; }
+
+int Canvas::Bottom() const {
+  return window_ ? getbegy(window_) + getmaxy(window_) : 0;
+}
+
+void Canvas::Begin(int row) {
+  row_.clear();
+  current_ = window_ && row >= inset_ && row < Height() - inset_ ? row : -1;
+}
+
+void Canvas::Text(int column, const char* text, int pair) {
+  if (current_ < 0) return;
+  auto length = static_cast<uint16_t>(std::min<std::size_t>(
+      std::strlen(text), std::max(Width() - inset_ - column, 0)));
+  char header[kHeaderSize];
+  auto at = static_cast<uint16_t>(column);
+  std::memcpy(header, &at, 2);
+  header[2] = static_cast<char>(pair);
+  std::memcpy(header + 3, &length, 2);
+  row_.append(header, kHeaderSize);
+  row_.append(text, length);
+}
+
+void Canvas::Format(int column, int pair, const char* format, ...) {
+  if (current_ < 0) return;
+  char text[512];
+  va_list args;
+  va_start(args, format);
+  std::vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  Text(column, text, pair);
+}
+
+void Canvas::End() {
+  if (current_ < 0) return;
+  if (row_ != shadow_[current_]) {
+    Draw(current_);
+    shadow_[current_].swap(row_);
+  }
+  current_ = -1;
+}
+
+void Canvas::ClearFrom(int row) {
+  for (int r = std::max(row, inset_); r < Height() - inset_; ++r) {
+    if (shadow_[r].empty()) continue;
+    mvwhline(window_, r, inset_, ' ', Width() - 2 * inset_);
+    shadow_[r].clear();
+  }
+}
+
+void Canvas::Stage() {
+  if (window_) wnoutrefresh(window_);
+}
+
+// Blank the row inside the border and write the composed segments
+void Canvas::Draw(int row) {
+  mvwhline(window_, row, inset_, ' ', Width() - 2 * inset_);
+  for (std::size_t p = 0; p + kHeaderSize <= row_.size();) {
+    uint16_t column;
+    uint16_t length;
+    std::memcpy(&column, &row_[p], 2);
+    int pair = static_cast<unsigned char>(row_[p + 2]);
+    std::memcpy(&length, &row_[p + 3], 2);
+    p += kHeaderSize;
+    if (pair != 0) wattron(window_, COLOR_PAIR(pair));
+    mvwaddnstr(window_, row, column, &row_[p], length);
+    if (pair != 0) wattroff(window_, COLOR_PAIR(pair));
+    p += length;
+  }
+}
@@ -0,0 +1,223 @@
+#include "cgroup_table.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "linux_parser.h"
+#include "proc_file_cache.h"
+
+namespace {
+const char* const kFileNames[] = {"/cpu.stat", "/memory.current",
+                                  "/io.stat", "/cpu.pressure"};
+
+// Return the mount point of the cgroup2 hierarchy from mountinfo, empty if
+// there is none
+std::string FindMount() {
+  std::ifstream stream(LinuxParser::ProcDirectory() + "self/mountinfo");
+  std::string line;
+  while (std::getline(stream, line)) {
+    // "36 25 0:31 / /sys/fs/cgroup rw,nosuid shared:9 - cgroup2 cgroup2 rw"
+    if (line.find(" - cgroup2 ") == std::string::npos) continue;
+    std::istringstream fields(line);
+    std::string id, parent, device, root, mount;
+    if (fields >> id >> parent >> device >> root >> mount) return mount;
+  }
+  return {};
+}
+
+// Return the value after key, e.g. "usage_usec " or "total=", in text
+bool Field(const char* text, const char* key, uint64_t& value) {
+  const char* p = std::strstr(text, key);
+  if (p == nullptr) return false;
+  value = std::strtoull(p + std::strlen(key), nullptr, 10);
+  return true;
+}
+
+float Rate(uint64_t now, uint64_t before, double elapsed) {
+  return now > before ? static_cast<float>((now - before) / elapsed) : 0.0f;
+}
+}  // namespace
+
+CgroupTable::CgroupTable() : mount_(FindMount()) {}
+
+CgroupTable::~CgroupTable() {
+  for (auto& entry : states_) Close(entry.second);
+}
+
+bool CgroupTable::Available() const { return !mount_.empty(); }
+
+// Read the cgroup of pid and return the id of its group, opening the group
+// if it is new; 0 if pid has gone or is outside our cgroup namespace
+int CgroupTable::GroupOf(int pid) {
+  if (ProcFileCache::Instance().ReadOnce(pid, "cgroup", buffer_,
+                                         sizeof(buffer_)) < 0)
+    return 0;
+  // The unified hierarchy is the "0::" line, after any v1 hierarchies
+  const char* line = buffer_;
+  while (std::strncmp(line, "0::", 3) != 0) {
+    line = std::strchr(line, '\n');
+    if (line == nullptr) return 0;
+    ++line;
+  }
+  line += 3;
+  const char* eol = std::strchr(line, '\n');
+  std::string path(line, eol == nullptr ? std::strlen(line) : eol - line);
+  if (path.empty() || path.compare(0, 3, "/..") == 0) return 0;
+
+  auto it = byPath_.find(path);
+  if (it != byPath_.end()) return it->second;
+  int id = nextId_++;
+  State& state = states_[id];
+  // The root group's files live at the mount point itself
+  std::string directory = path == "/" ? mount_ : mount_ + path;
+  for (int file = 0; file < kFiles; ++file) {
+    state.fds[file] = ProcFileCache::Instance().OpenFile(
+        (directory + kFileNames[file]).c_str());
+  }
+  state.path = path;
+  byPath_.emplace(std::move(path), id);
+  return id;
+}
+
+void CgroupTable::Update(const std::vector<int>& pids, double elapsed,
+                         long cpus, const std::vector<int>& expanded) {
+  ++tick_;
+  if (mount_.empty()) {
+    groups_.clear();
+    return;
+  }
+  for (auto& entry : states_) entry.second.processes = 0;
+  for (int pid : pids) {
+    auto it = members_.find(pid);
+    if (it == members_.end()) {
+      it = members_.emplace(pid, Membership{GroupOf(pid), 0}).first;
+    }
+    it->second.seen = tick_;
+    if (it->second.group != 0) ++states_[it->second.group].processes;
+  }
+
+  // Forget PIDs that have gone and the groups they leave empty
+  for (auto it = members_.begin(); it != members_.end();) {
+    it = it->second.seen == tick_ ? std::next(it) : members_.erase(it);
+  }
+  for (auto it = states_.begin(); it != states_.end();) {
+    if (it->second.processes == 0) {
+      Close(it->second);
+      byPath_.erase(it->second.path);
+      it = states_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Existing elements keep their storage
+  groups_.resize(states_.size());
+  std::size_t i = 0;
+  for (auto& entry : states_) {
+    Group& group = groups_[i++];
+    group.id = entry.first;
+    group.members.clear();
+    Read(entry.second, group, elapsed, cpus);
+  }
+  if (expanded.empty()) return;
+  for (const auto& entry : members_) {
+    if (std::find(expanded.begin(), expanded.end(), entry.second.group) ==
+        expanded.end())
+      continue;
+    for (Group& group : groups_) {
+      if (group.id == entry.second.group)
+        group.members.push_back(entry.first);
+    }
+  }
+  for (Group& group : groups_) {
+    std::sort(group.members.begin(), group.members.end());
+  }
+}
+
+// Read the totals of a group and turn the counters into rates
+void CgroupTable::Read(State& state, Group& group, double elapsed,
+                       long cpus) {
+  ProcFileCache& cache = ProcFileCache::Instance();
+  bool rates = state.sampled && elapsed > 0;
+  group.path = state.path;
+  group.processes = state.processes;
+  group.cpuUtilization = 0.0;
+  uint64_t usage;
+  if (state.fds[kCpuStat] >= 0 &&
+      cache.ReadFile(state.fds[kCpuStat], buffer_, sizeof(buffer_)) >= 0 &&
+      Field(buffer_, "usage_usec ", usage)) {
+    if (rates && cpus > 0) {
+      group.cpuUtilization = Rate(usage, state.usageUs, elapsed) / 1e6f /
+                             static_cast<float>(cpus);
+    }
+    state.usageUs = usage;
+  }
+
+  group.memoryKnown =
+      state.fds[kMemory] >= 0 &&
+      cache.ReadFile(state.fds[kMemory], buffer_, sizeof(buffer_)) > 0;
+  group.memoryBytes =
+      group.memoryKnown ? std::strtoull(buffer_, nullptr, 10) : 0;
+
+  group.ioKnown = state.fds[kIoStat] >= 0 &&
+                  cache.ReadFile(state.fds[kIoStat], buffer_,
+                                 sizeof(buffer_)) >= 0;
+  group.readRate = group.writeRate = 0.0;
+  if (group.ioKnown) {
+    // One "MAJ:MIN rbytes=... wbytes=... rios=..." line per device
+    uint64_t read = 0, written = 0;
+    for (const char* line = buffer_; *line != '\0';) {
+      uint64_t value;
+      if (Field(line, "rbytes=", value)) read += value;
+      if (Field(line, "wbytes=", value)) written += value;
+      const char* eol = std::strchr(line, '\n');
+      if (eol == nullptr) break;
+      line = eol + 1;
+    }
+    if (rates) {
+      group.readRate = Rate(read, state.readBytes, elapsed);
+      group.writeRate = Rate(written, state.writtenBytes, elapsed);
+    }
+    state.readBytes = read;
+    state.writtenBytes = written;
+  }
+
+  uint64_t stall;
+  group.stallKnown =
+      state.fds[kCpuPressure] >= 0 &&
+      cache.ReadFile(state.fds[kCpuPressure], buffer_, sizeof(buffer_)) >=
+          0 &&
+      Field(buffer_, "total=", stall);
+  group.cpuStall = 0.0;
+  if (group.stallKnown) {
+    if (rates) {
+      group.cpuStall =
+          std::min(1.0f, Rate(stall, state.stallUs, elapsed) / 1e6f);
+    }
+    state.stallUs = stall;
+  }
+  state.sampled = true;
+}
+
+void CgroupTable::Close(State& state) {
+  for (int fd : state.fds) ProcFileCache::Instance().CloseFile(fd);
+}
+
+std::vector<CgroupTable::Group>& CgroupTable::Groups() { return groups_; }
+
+const std::vector<CgroupTable::Group>& CgroupTable::Groups() const {
+  return groups_;
+}
+
+void CgroupTable::Members(const std::vector<int>& ids,
+                          std::vector<int>& pids) const {
+  for (const Group& group : groups_) {
+    if (std::find(ids.begin(), ids.end(), group.id) != ids.end()) {
+      pids.insert(pids.end(), group.members.begin(), group.members.end());
+    }
+  }
+}
@@ -0,0 +1,88 @@
+#include "disk_stats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "proc_file_cache.h"
+
+namespace {
+// diskstats counts 512-byte sectors whatever the device's block size
+constexpr float kSectorSize = 512.0f;
+
+bool Ignored(const char* name) {
+  return std::strncmp(name, "loop", 4) == 0 ||
+         std::strncmp(name, "ram", 3) == 0;
+}
+
+// Return true if name is a partition of disk: "sda1" of "sda",
+// "nvme0n1p2" of "nvme0n1"
+bool PartitionOf(const std::string& name, const std::string& disk) {
+  if (name.size() <= disk.size() || name.compare(0, disk.size(), disk) != 0)
+    return false;
+  std::size_t i = disk.size();
+  if (name[i] == 'p') ++i;
+  if (i == name.size()) return false;
+  for (; i < name.size(); ++i) {
+    if (name[i] < '0' || name[i] > '9') return false;
+  }
+  return true;
+}
+
+float Rate(uint64_t now, uint64_t before, double elapsed) {
+  return now > before ? static_cast<float>((now - before) / elapsed) : 0.0f;
+}
+}  // namespace
+
+bool DiskStats::Read(double elapsed) {
+  devices_.clear();
+  counters_.clear();
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kDiskstats,
+                                     buffer_))
+    return false;
+  const char* p = buffer_.c_str();
+  while (*p != '\0') {
+    const char* eol = std::strchr(p, '\n');
+    if (eol == nullptr) eol = p + std::strlen(p);
+    char name[64];
+    unsigned long long reads, readsMerged, sectorsRead, readMs, writes,
+        writesMerged, sectorsWritten, writeMs, inFlight, ioMs;
+    int fields = std::sscanf(
+        p, "%*u %*u %63s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+        name, &reads, &readsMerged, &sectorsRead, &readMs, &writes,
+        &writesMerged, &sectorsWritten, &writeMs, &inFlight, &ioMs);
+    p = *eol == '\0' ? eol : eol + 1;
+    if (fields != 11 || Ignored(name) || reads + writes == 0) continue;
+    Device device;
+    device.name = name;
+    // Partitions follow their disk
+    if (!devices_.empty() && PartitionOf(device.name, devices_.back().name))
+      continue;
+    devices_.push_back(std::move(device));
+    counters_.push_back({reads, sectorsRead, writes, sectorsWritten, ioMs});
+  }
+
+  for (std::size_t i = 0; i < devices_.size(); ++i) {
+    Device& device = devices_[i];
+    const Counters& now = counters_[i];
+    auto it = previous_.find(device.name);
+    if (it != previous_.end() && elapsed > 0) {
+      const Counters& before = it->second;
+      device.readRate =
+          Rate(now.sectorsRead, before.sectorsRead, elapsed) * kSectorSize;
+      device.writeRate =
+          Rate(now.sectorsWritten, before.sectorsWritten, elapsed) *
+          kSectorSize;
+      device.iops = Rate(now.reads + now.writes, before.reads + before.writes,
+                         elapsed);
+      device.utilization = Rate(now.ioMs, before.ioMs, elapsed) / 1000.0f;
+      if (device.utilization > 1.0f) device.utilization = 1.0f;
+    }
+    previous_[device.name] = now;
+  }
+  return true;
+}
+
+const std::vector<DiskStats::Device>& DiskStats::Devices() const {
+  return devices_;
+}
@@ -1,5 +1,6 @@
 #include "format.h"
 
+#include <cstdio>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -19,4 +20,19 @@ string Format::ElapsedTime(long seconds) {
       << std::setw(2) << std::setfill('0') << sec;
 
   return oss.str();
-}
\ No newline at end of file
+}
+
+void Format::ElapsedTime(long seconds, char* buffer, std::size_t size) {
+  std::snprintf(buffer, size, "%02ld:%02ld:%02ld", seconds / 3600,
+                (seconds % 3600) / 60, seconds % 60);
+}
+
+void Format::Rate(float bytesPerSecond, char* buffer, std::size_t size) {
+  static const char* const units[] = {"B/s", "KB/s", "MB/s", "GB/s"};
+  std::size_t unit = 0;
+  while (bytesPerSecond >= 1024 && unit < 3) {
+    bytesPerSecond /= 1024;
+    ++unit;
+  }
+  std::snprintf(buffer, size, "%6.1f %s", bytesPerSecond, units[unit]);
+}
@@ -0,0 +1,94 @@
+#include "headless.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "history_file.h"
+#include "snapshot.h"
+#include "snapshot_writer.h"
+#include "stall_triggers.h"
+
+namespace {
+std::atomic<bool> stop{false};
+
+void Stop(int) { stop = true; }
+}  // namespace
+
+int Headless::Run(System& system, const Options& options) {
+  int fd = STDOUT_FILENO;
+  if (!options.output.empty()) {
+    fd = open(options.output.c_str(),
+              O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      std::fprintf(stderr, "monitor: %s: %s\n", options.output.c_str(),
+                   std::strerror(errno));
+      return 1;
+    }
+  }
+  HistoryFile history;
+  if (!options.history.empty() &&
+      !history.Create(options.history, options.historySize)) {
+    std::fprintf(stderr, "monitor: %s: cannot create history file\n",
+                 options.history.c_str());
+    if (fd != STDOUT_FILENO) close(fd);
+    return 1;
+  }
+  std::signal(SIGINT, Stop);
+  std::signal(SIGTERM, Stop);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  std::size_t rows = options.rows == 0
+                         ? std::numeric_limits<std::size_t>::max()
+                         : options.rows;
+  StallTriggers triggers;
+  if (options.stallTrigger.count() > 0 &&
+      triggers.Open(options.stallTrigger) == 0) {
+    std::fprintf(stderr, "monitor: cannot arm PSI triggers\n");
+  }
+  Snapshot snapshot;
+  bool ok = true;
+  // Failed history appends are reported once
+  bool unrecorded = false;
+  {
+    SnapshotWriter writer(fd, options.format);
+    auto next = std::chrono::steady_clock::now();
+    bool stalled = false;
+    for (std::size_t n = 1; !stop && ok; ++n) {
+      snapshot.Collect(system, rows, options.sortKey);
+      snapshot.tick = n;
+      snapshot.stallTriggered = stalled;
+      ok = writer.Write(snapshot);
+      if (!options.history.empty() && !history.Append(snapshot) &&
+          !unrecorded) {
+        std::fprintf(stderr,
+                     "monitor: %s: snapshot %zu too large to record, history "
+                     "is incomplete\n",
+                     options.history.c_str(), n);
+        unrecorded = true;
+      }
+      if (options.count != 0 && n >= options.count) break;
+      // Keep a fixed cadence, but don't try to catch up after a slow scan;
+      // a stall sample comes on top of it
+      if (!stalled) {
+        next = std::max(next + options.interval,
+                        std::chrono::steady_clock::now());
+      }
+      stalled = false;
+      while (!stop && !stalled && std::chrono::steady_clock::now() < next) {
+        stalled = triggers.Wait(next);
+      }
+    }
+    ok = writer.Flush() && ok;
+  }
+  if (fd != STDOUT_FILENO) close(fd);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,529 @@
+#include "history_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "processor.h"
+
+namespace {
+constexpr char kMagic[8] = "SMHIST1";
+constexpr uint32_t kVersion = 5;
+// The header owns the first page, records fill the rest of the file
+constexpr std::size_t kHeaderSize = 4096;
+// Length word telling readers to continue at the start of the data region
+constexpr uint32_t kWrap = 0xffffffff;
+constexpr uint8_t kKeyframe = 1;
+constexpr std::size_t kMaxCommand = 128;
+constexpr std::size_t kMaxName = 64;
+constexpr std::size_t kMaxPath = 256;
+// Flags of a recorded group's known values
+constexpr uint8_t kMemoryKnown = 1;
+constexpr uint8_t kIoKnown = 2;
+constexpr uint8_t kStallKnown = 4;
+
+void PutVarint(std::string& buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  buffer += static_cast<char>(value);
+}
+
+void PutSigned(std::string& buffer, int64_t value) {
+  PutVarint(buffer, (static_cast<uint64_t>(value) << 1) ^
+                        static_cast<uint64_t>(value >> 63));
+}
+
+// Percentages in units of 0.01%, offset by one so 0 can mean "no data"
+void PutFraction(std::string& buffer, float value) {
+  if (!(value >= 0)) {
+    PutVarint(buffer, 0);
+    return;
+  }
+  PutVarint(buffer, static_cast<uint64_t>(std::lround(value * 10000)) + 1);
+}
+
+// Non-negative rates and averages in units of 1/scale, rounded
+void PutScaled(std::string& buffer, float value, float scale) {
+  PutVarint(buffer, value > 0 ? static_cast<uint64_t>(
+                                    std::llround(value * scale))
+                              : 0);
+}
+
+void PutString(std::string& buffer, std::string_view value,
+               std::size_t limit) {
+  std::size_t length = std::min(value.size(), limit);
+  PutVarint(buffer, length);
+  buffer.append(value.data(), length);
+}
+
+// Bounds checked cursor over one record; any overrun clears ok
+struct Cursor {
+  const unsigned char* p;
+  const unsigned char* end;
+  bool ok = true;
+
+  uint64_t Varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (p == end) break;
+      unsigned char byte = *p++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    ok = false;
+    return 0;
+  }
+
+  int64_t Signed() {
+    uint64_t value = Varint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  float Fraction() {
+    uint64_t value = Varint();
+    return value == 0 ? Processor::kOffline : (value - 1) / 10000.0f;
+  }
+
+  float Scaled(float scale) { return Varint() / scale; }
+
+  void String(std::string& value) {
+    uint64_t length = Varint();
+    if (length > static_cast<uint64_t>(end - p)) {
+      ok = false;
+      return;
+    }
+    value.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+  }
+};
+}  // namespace
+
+struct HistoryFile::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t keyInterval;
+  // Size of the data region and offsets into it
+  uint64_t capacity;
+  uint64_t head;
+  uint64_t tail;
+  uint64_t count;
+  // Records ever appended, including overwritten ones
+  uint64_t sequence;
+  // Constant for a recording, so kept here instead of in every record
+  char operatingSystem[128];
+  char kernel[128];
+};
+
+HistoryFile::~HistoryFile() { Unmap(); }
+
+bool HistoryFile::Create(const std::string& path, std::size_t size) {
+  static_assert(sizeof(Header) <= kHeaderSize, "header fits its page");
+  Unmap();
+  if (size < 2 * kHeaderSize) return false;
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == size &&
+      Map(fd, size, true) && std::memcmp(header_->magic, kMagic, 8) == 0 &&
+      header_->version == kVersion &&
+      header_->capacity == size - kHeaderSize) {
+    // Keep appending to the existing recording
+    needKey_ = true;
+    return true;
+  }
+  Unmap();
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  // Allocate the blocks up front so a full disk fails here rather than
+  // with SIGBUS on a later store into the mapping
+  if (posix_fallocate(fd, 0, size) != 0 && ftruncate(fd, size) != 0) {
+    close(fd);
+    return false;
+  }
+  if (!Map(fd, size, true)) return false;
+  std::memset(header_, 0, sizeof(Header));
+  std::memcpy(header_->magic, kMagic, 8);
+  header_->version = kVersion;
+  header_->keyInterval = kKeyInterval;
+  header_->capacity = size - kHeaderSize;
+  needKey_ = true;
+  return true;
+}
+
+bool HistoryFile::Open(const std::string& path) {
+  Unmap();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < 2 * kHeaderSize) {
+    close(fd);
+    return false;
+  }
+  if (!Map(fd, st.st_size, false)) return false;
+  if (std::memcmp(header_->magic, kMagic, 8) != 0 ||
+      header_->version != kVersion ||
+      header_->capacity != size_ - kHeaderSize) {
+    Unmap();
+    return false;
+  }
+  return true;
+}
+
+bool HistoryFile::Map(int fd, std::size_t size, bool write) {
+  int protection = write ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* map = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  map_ = static_cast<char*>(map);
+  size_ = size;
+  header_ = reinterpret_cast<Header*>(map_);
+  return true;
+}
+
+void HistoryFile::Unmap() {
+  if (map_ != nullptr) munmap(map_, size_);
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  map_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  index_.clear();
+  decoded_ = 0;
+}
+
+// Return the offset of the record following the one at offset, resolving
+// wrap markers and the end of the data region to 0
+std::size_t HistoryFile::Next(std::size_t offset) const {
+  const char* data = map_ + kHeaderSize;
+  uint32_t length;
+  std::memcpy(&length, data + offset, sizeof(length));
+  offset += sizeof(length) + length;
+  if (offset + sizeof(length) > header_->capacity) return 0;
+  std::memcpy(&length, data + offset, sizeof(length));
+  return length == kWrap ? 0 : offset;
+}
+
+bool HistoryFile::Append(const Snapshot& snapshot) {
+  if (header_ == nullptr) return false;
+  Header& header = *header_;
+  bool key = needKey_ || header.sequence % header.keyInterval == 0;
+  if (key) written_ = {};
+
+  record_.assign(sizeof(uint32_t), '\0');
+  record_ += static_cast<char>(key ? kKeyframe : 0);
+  PutVarint(record_, snapshot.tick - written_.tick);
+  PutSigned(record_, snapshot.time - written_.time);
+  PutSigned(record_, snapshot.upTime - written_.upTime);
+  PutSigned(record_, snapshot.totalProcesses - written_.totalProcesses);
+  PutSigned(record_, snapshot.contextSwitches - written_.contextSwitches);
+  PutSigned(record_, snapshot.interrupts - written_.interrupts);
+  PutFraction(record_, snapshot.cpuUtilization);
+  PutFraction(record_, snapshot.memoryUtilization);
+  PutFraction(record_, snapshot.swapUtilization);
+  PutVarint(record_, snapshot.coreUtilization.size());
+  for (float core : snapshot.coreUtilization) PutFraction(record_, core);
+  PutVarint(record_, snapshot.runningProcesses);
+  PutVarint(record_, snapshot.blockedProcesses);
+  record_ += static_cast<char>(snapshot.processEvents);
+  if (snapshot.processEvents) {
+    PutVarint(record_, snapshot.exitedProcesses);
+    PutVarint(record_, snapshot.shortLivedProcesses);
+    PutFraction(record_, snapshot.exitedCpuUtilization);
+  }
+  for (float load : snapshot.loadAverage) PutScaled(record_, load, 100);
+  for (const auto& pressure : snapshot.pressure) {
+    record_ += static_cast<char>(pressure.available);
+    if (!pressure.available) continue;
+    for (const auto* stall : {&pressure.some, &pressure.full}) {
+      PutFraction(record_, stall->avg10);
+      PutFraction(record_, stall->avg60);
+      PutFraction(record_, stall->interval);
+      PutVarint(record_, stall->totalUs);
+    }
+  }
+  PutVarint(record_, snapshot.disks.size());
+  for (const auto& disk : snapshot.disks) {
+    PutString(record_, disk.name, kMaxName);
+    PutScaled(record_, disk.readRate, 1);
+    PutScaled(record_, disk.writeRate, 1);
+    PutScaled(record_, disk.iops, 10);
+    PutFraction(record_, disk.utilization);
+  }
+  PutVarint(record_, snapshot.interfaces.size());
+  for (const auto& interface : snapshot.interfaces) {
+    PutString(record_, interface.name, kMaxName);
+    PutScaled(record_, interface.rxRate, 1);
+    PutScaled(record_, interface.txRate, 1);
+    PutScaled(record_, interface.rxPackets, 10);
+    PutScaled(record_, interface.txPackets, 10);
+    PutScaled(record_, interface.errors, 10);
+    PutScaled(record_, interface.drops, 10);
+    PutScaled(record_, interface.peak, 1);
+  }
+  // While grouped, processes only holds the members of expanded groups
+  record_ += static_cast<char>(snapshot.grouped |
+                               snapshot.cgroupsAvailable << 1);
+  PutVarint(record_, snapshot.groups.size());
+  for (const auto& group : snapshot.groups) {
+    PutVarint(record_, group.id);
+    PutString(record_, group.path, kMaxPath);
+    PutVarint(record_, group.processes);
+    record_ += static_cast<char>((group.memoryKnown ? kMemoryKnown : 0) |
+                                 (group.ioKnown ? kIoKnown : 0) |
+                                 (group.stallKnown ? kStallKnown : 0));
+    PutFraction(record_, group.cpuUtilization);
+    PutFraction(record_, group.cpuStall);
+    PutVarint(record_, group.memoryBytes);
+    PutScaled(record_, group.readRate, 1);
+    PutScaled(record_, group.writeRate, 1);
+    // Ascending, so stored as gaps
+    PutVarint(record_, group.members.size());
+    int previous = 0;
+    for (int pid : group.members) {
+      PutVarint(record_, pid - previous);
+      previous = pid;
+    }
+  }
+  PutVarint(record_, snapshot.processes.size());
+  for (const Process& process : snapshot.processes) {
+    PutVarint(record_, process.Pid());
+    PutFraction(record_, process.CpuUtilization());
+    PutString(record_, process.User(), kMaxCommand);
+    PutString(record_, process.Command(), kMaxCommand);
+    // PSS and swap are stored plus one, with 0 for not measured
+    Process::Memory ram = process.Ram();
+    PutVarint(record_, ram.rssKb);
+    PutVarint(record_, ram.sharedKb);
+    PutVarint(record_, ram.accurate ? ram.pssKb + 1 : 0);
+    PutVarint(record_, ram.accurate ? ram.swapKb + 1 : 0);
+    // I/O rates in bytes per second, likewise plus one
+    Process::Io io = process.DiskIo();
+    PutVarint(record_, io.known ? static_cast<uint64_t>(io.readRate) + 1 : 0);
+    PutVarint(record_, io.known ? static_cast<uint64_t>(io.writeRate) + 1 : 0);
+    PutSigned(record_, process.UpTime());
+  }
+  uint32_t length = record_.size() - sizeof(uint32_t);
+  std::memcpy(&record_[0], &length, sizeof(length));
+
+  // Leave room for a wrap marker so readers always find one
+  std::size_t n = record_.size();
+  if (n + sizeof(kWrap) > header.capacity) return false;
+  char* data = map_ + kHeaderSize;
+  std::size_t head = header.head;
+  if (head + n > header.capacity) {
+    // Drop whatever is left of the previous lap and start over at 0
+    while (header.count > 0 && header.tail >= head) {
+      header.tail = Next(header.tail);
+      --header.count;
+    }
+    if (head + sizeof(kWrap) <= header.capacity)
+      std::memcpy(data + head, &kWrap, sizeof(kWrap));
+    head = 0;
+  }
+  // Drop the oldest records the new one overlaps
+  while (header.count > 0 && header.tail >= head && header.tail < head + n) {
+    header.tail = Next(header.tail);
+    --header.count;
+  }
+  if (header.count == 0) header.tail = head;
+  std::memcpy(data + head, record_.data(), n);
+  header.head = head + n;
+  ++header.count;
+  ++header.sequence;
+
+  if (std::strncmp(header.operatingSystem, snapshot.operatingSystem.c_str(),
+                   sizeof(header.operatingSystem) - 1) != 0 ||
+      std::strncmp(header.kernel, snapshot.kernel.c_str(),
+                   sizeof(header.kernel) - 1) != 0) {
+    std::snprintf(header.operatingSystem, sizeof(header.operatingSystem),
+                  "%s", snapshot.operatingSystem.c_str());
+    std::snprintf(header.kernel, sizeof(header.kernel), "%s",
+                  snapshot.kernel.c_str());
+  }
+  written_.tick = snapshot.tick;
+  written_.time = snapshot.time;
+  written_.upTime = snapshot.upTime;
+  written_.totalProcesses = snapshot.totalProcesses;
+  written_.contextSwitches = snapshot.contextSwitches;
+  written_.interrupts = snapshot.interrupts;
+  needKey_ = false;
+  return true;
+}
+
+std::size_t HistoryFile::Load() {
+  index_.clear();
+  decoded_ = 0;
+  if (header_ == nullptr) return 0;
+  const char* data = map_ + kHeaderSize;
+  std::size_t offset = header_->tail;
+  for (uint64_t i = 0; i < header_->count; ++i) {
+    uint32_t length;
+    if (offset + sizeof(length) + 1 > header_->capacity) break;
+    std::memcpy(&length, data + offset, sizeof(length));
+    if (length == 0 || offset + sizeof(length) + length > header_->capacity)
+      break;
+    // Deltas before the first keyframe have nothing to apply to
+    if (!index_.empty() || (data[offset + sizeof(length)] & kKeyframe))
+      index_.push_back(offset);
+    if (i + 1 < header_->count) offset = Next(offset);
+  }
+  return index_.size();
+}
+
+std::size_t HistoryFile::Count() const { return index_.size(); }
+
+bool HistoryFile::Read(std::size_t index, Snapshot& snapshot) {
+  if (index >= index_.size()) return false;
+  const char* data = map_ + kHeaderSize;
+  // Continue from the previous read when stepping forward by one, else
+  // replay from the closest keyframe
+  std::size_t from = index;
+  if (decoded_ != index) {
+    while (from > 0 && !(data[index_[from] + sizeof(uint32_t)] & kKeyframe))
+      --from;
+  }
+  snapshot.operatingSystem = header_->operatingSystem;
+  snapshot.kernel = header_->kernel;
+  for (std::size_t i = from; i <= index; ++i) {
+    if (!Decode(index_[i], read_, i == index ? &snapshot : nullptr)) {
+      decoded_ = 0;
+      return false;
+    }
+  }
+  decoded_ = index + 1;
+  return true;
+}
+
+// Decode the record at offset, advancing counters; the rest of the fields
+// are only stored when snapshot is set
+bool HistoryFile::Decode(std::size_t offset, Counters& counters,
+                         Snapshot* snapshot) {
+  const char* data = map_ + kHeaderSize;
+  uint32_t length;
+  std::memcpy(&length, data + offset, sizeof(length));
+  auto begin =
+      reinterpret_cast<const unsigned char*>(data + offset + sizeof(length));
+  Cursor in{begin + 1, begin + length};
+  if (*begin & kKeyframe) counters = {};
+  counters.tick += in.Varint();
+  counters.time += in.Signed();
+  counters.upTime += in.Signed();
+  counters.totalProcesses += in.Signed();
+  counters.contextSwitches += in.Signed();
+  counters.interrupts += in.Signed();
+  if (!in.ok) return false;
+  if (snapshot == nullptr) return true;
+
+  Snapshot& out = *snapshot;
+  out.tick = counters.tick;
+  out.time = counters.time;
+  out.upTime = counters.upTime;
+  out.totalProcesses = counters.totalProcesses;
+  out.contextSwitches = counters.contextSwitches;
+  out.interrupts = counters.interrupts;
+  out.cpuUtilization = in.Fraction();
+  out.memoryUtilization = in.Fraction();
+  out.swapUtilization = in.Fraction();
+  out.coreUtilization.resize(std::min<uint64_t>(in.Varint(), length));
+  for (float& core : out.coreUtilization) core = in.Fraction();
+  out.runningProcesses = in.Varint();
+  out.blockedProcesses = in.Varint();
+  out.processEvents = in.p < in.end && *in.p++ != 0;
+  if (out.processEvents) {
+    out.exitedProcesses = in.Varint();
+    out.shortLivedProcesses = in.Varint();
+    out.exitedCpuUtilization = in.Fraction();
+  }
+  for (float& load : out.loadAverage) load = in.Scaled(100);
+  for (auto& pressure : out.pressure) {
+    pressure = {};
+    pressure.available = in.p < in.end && *in.p++ != 0;
+    if (!pressure.available) continue;
+    for (auto* stall : {&pressure.some, &pressure.full}) {
+      stall->avg10 = in.Fraction();
+      stall->avg60 = in.Fraction();
+      stall->interval = in.Fraction();
+      stall->totalUs = in.Varint();
+    }
+  }
+  out.disks.resize(std::min<uint64_t>(in.Varint(), length));
+  for (auto& disk : out.disks) {
+    in.String(disk.name);
+    disk.readRate = in.Scaled(1);
+    disk.writeRate = in.Scaled(1);
+    disk.iops = in.Scaled(10);
+    disk.utilization = in.Fraction();
+  }
+  out.interfaces.resize(std::min<uint64_t>(in.Varint(), length));
+  for (auto& interface : out.interfaces) {
+    in.String(interface.name);
+    interface.rxRate = in.Scaled(1);
+    interface.txRate = in.Scaled(1);
+    interface.rxPackets = in.Scaled(10);
+    interface.txPackets = in.Scaled(10);
+    interface.errors = in.Scaled(10);
+    interface.drops = in.Scaled(10);
+    interface.peak = in.Scaled(1);
+  }
+  uint8_t grouping = in.p < in.end ? *in.p++ : 0;
+  out.grouped = grouping & 1;
+  out.cgroupsAvailable = grouping & 2;
+  out.groups.resize(std::min<uint64_t>(in.Varint(), length));
+  for (auto& group : out.groups) {
+    group.id = in.Varint();
+    in.String(group.path);
+    group.processes = in.Varint();
+    uint8_t known = in.p < in.end ? *in.p++ : 0;
+    group.memoryKnown = known & kMemoryKnown;
+    group.ioKnown = known & kIoKnown;
+    group.stallKnown = known & kStallKnown;
+    group.cpuUtilization = in.Fraction();
+    group.cpuStall = in.Fraction();
+    group.memoryBytes = in.Varint();
+    group.readRate = in.Scaled(1);
+    group.writeRate = in.Scaled(1);
+    group.members.resize(std::min<uint64_t>(in.Varint(), length));
+    int pid = 0;
+    for (int& member : group.members) member = pid += in.Varint();
+  }
+  std::size_t processes = std::min<uint64_t>(in.Varint(), length);
+  out.processes.Clear();
+  std::string user;
+  std::string command;
+  for (std::size_t i = 0; i < processes && in.ok; ++i) {
+    int pid = in.Varint();
+    float cpu = in.Fraction();
+    in.String(user);
+    in.String(command);
+    Process::Memory ram;
+    ram.rssKb = in.Varint();
+    ram.sharedKb = in.Varint();
+    uint64_t pss = in.Varint();
+    uint64_t swap = in.Varint();
+    ram.accurate = pss != 0;
+    ram.pssKb = pss != 0 ? pss - 1 : 0;
+    ram.swapKb = swap != 0 ? swap - 1 : 0;
+    Process::Io io;
+    uint64_t read = in.Varint();
+    uint64_t written = in.Varint();
+    io.known = read != 0;
+    io.readRate = read != 0 ? static_cast<float>(read - 1) : 0.0f;
+    io.writeRate = written != 0 ? static_cast<float>(written - 1) : 0.0f;
+    long upTime = in.Signed();
+    out.processes.Append(pid, cpu, user, command, ram, io, upTime);
+  }
+  return in.ok;
+}
@@ -0,0 +1,17 @@
+#include "host_info.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "linux_parser.h"
+
+// Re-read every field; sysconf(_SC_NPROCESSORS_ONLN) parses a sysfs file
+// on each call, so it is only done here
+void HostInfo::Read() {
+  operatingSystem = LinuxParser::OperatingSystem();
+  kernel = LinuxParser::Kernel();
+  clockTicks = std::max(sysconf(_SC_CLK_TCK), 1L);
+  onlineCpus = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  pageKb = std::max(sysconf(_SC_PAGESIZE) / 1024, 1L);
+}
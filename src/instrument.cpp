@@ -0,0 +1,146 @@
+#include "instrument.h"
+
+#include <time.h>
+
+#include <atomic>
+
+namespace {
+const char* const kNames[] = {"snapshot", "cpu",     "enumerate", "parse",
+                              "update",   "io",      "cgroups",   "filter",
+                              "sort",     "details", "threads",   "draw"};
+}  // namespace
+
+const char* Instrument::Name(Phase phase) {
+  auto index = static_cast<std::size_t>(phase);
+  return index < kPhases ? kNames[index] : "none";
+}
+
+#if MONITOR_INSTRUMENT
+
+namespace {
+using Instrument::Phase;
+using Instrument::kCounters;
+using Instrument::kPhases;
+
+// Bucket b > 0 holds durations in [2^(b-1), 2^b) microseconds
+constexpr std::size_t kBuckets = 32;
+
+struct PhaseData {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> lastNs{0};
+  std::array<std::atomic<uint64_t>, kBuckets> buckets = {};
+  std::array<std::atomic<uint64_t>, kCounters> totals = {};
+  std::array<std::atomic<uint64_t>, kCounters> last = {};
+};
+
+PhaseData phases[kPhases];
+
+// Counts since the last flush, credited to the thread's current phase
+struct ThreadState {
+  Phase phase = Phase::kNone;
+  uint64_t pending[kCounters] = {};
+};
+
+thread_local ThreadState state;
+
+uint64_t Now() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void Flush() {
+  if (state.phase == Phase::kNone) {
+    for (auto& count : state.pending) count = 0;
+    return;
+  }
+  auto& totals = phases[static_cast<std::size_t>(state.phase)].totals;
+  for (std::size_t i = 0; i < kCounters; ++i) {
+    if (state.pending[i] == 0) continue;
+    totals[i].fetch_add(state.pending[i], std::memory_order_relaxed);
+    state.pending[i] = 0;
+  }
+}
+
+// Flush what was counted so far and switch the thread to phase
+Phase Enter(Phase phase) {
+  Flush();
+  Phase previous = state.phase;
+  state.phase = phase;
+  return previous;
+}
+
+std::size_t Bucket(uint64_t us) {
+  std::size_t bucket = 0;
+  while (us != 0 && bucket + 1 < kBuckets) {
+    us >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+// Upper bound of the bucket holding the q-th quantile
+uint64_t Percentile(const PhaseData& data, double q) {
+  uint64_t total = 0;
+  for (const auto& count : data.buckets) total += count;
+  auto wanted = static_cast<uint64_t>(q * total);
+  uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += data.buckets[bucket];
+    if (seen > wanted) return uint64_t{1} << bucket;
+  }
+  return uint64_t{1} << (kBuckets - 1);
+}
+}  // namespace
+
+Instrument::Scope::Scope(Phase phase)
+    : phase_(phase), previous_(Enter(phase)), start_(Now()) {
+  const auto& totals = phases[static_cast<std::size_t>(phase_)].totals;
+  for (std::size_t i = 0; i < kCounters; ++i) counters_[i] = totals[i];
+}
+
+Instrument::Scope::~Scope() {
+  Flush();
+  uint64_t elapsed = Now() - start_;
+  PhaseData& data = phases[static_cast<std::size_t>(phase_)];
+  data.calls.fetch_add(1, std::memory_order_relaxed);
+  data.lastNs.store(elapsed, std::memory_order_relaxed);
+  data.buckets[Bucket(elapsed / 1000)].fetch_add(1, std::memory_order_relaxed);
+  for (std::size_t i = 0; i < kCounters; ++i)
+    data.last[i].store(data.totals[i] - counters_[i],
+                       std::memory_order_relaxed);
+  state.phase = previous_;
+}
+
+Instrument::Adopt::Adopt(Phase phase) : previous_(Enter(phase)) {}
+
+Instrument::Adopt::~Adopt() { Enter(previous_); }
+
+Instrument::Phase Instrument::Current() { return state.phase; }
+
+void Instrument::Count(Counter counter, uint64_t n) {
+  state.pending[static_cast<std::size_t>(counter)] += n;
+}
+
+void Instrument::Read(std::vector<PhaseStats>& stats) {
+  stats.clear();
+  for (std::size_t i = 0; i < kPhases; ++i) {
+    const PhaseData& data = phases[i];
+    if (data.calls == 0) continue;
+    PhaseStats phase;
+    phase.phase = static_cast<Phase>(i);
+    phase.calls = data.calls;
+    phase.lastUs = data.lastNs / 1000;
+    phase.p50Us = Percentile(data, 0.5);
+    phase.p99Us = Percentile(data, 0.99);
+    for (std::size_t c = 0; c < kCounters; ++c)
+      phase.counters[c] = data.last[c];
+    stats.push_back(phase);
+  }
+}
+
+#else
+
+void Instrument::Read(std::vector<PhaseStats>& stats) { stats.clear(); }
+
+#endif
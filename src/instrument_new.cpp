@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "instrument.h"
+
+// Replacements of the global allocation functions that count every
+// allocation made through operator new. Only the monitor links this file,
+// so libraries and benches keep the standard allocator. The array forms
+// forward to these by default.
+
+namespace {
+void* Allocate(std::size_t size) {
+  INSTRUMENT_COUNT(kAllocations, 1);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+  INSTRUMENT_COUNT(kAllocations, 1);
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc() wants a multiple of the alignment
+  std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) &
+                        ~(align - 1);
+  return std::aligned_alloc(align, rounded);
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (void* p = Allocate(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  if (void* p = AllocateAligned(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  std::free(p);
+}
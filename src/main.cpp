@@ -1,7 +1,57 @@
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "headless.h"
+#include "history_file.h"
+#include "linux_parser.h"
 #include "ncurses_display.h"
+#include "options.h"
+#include "proc_file_cache.h"
+#include "process_filter.h"
 #include "system.h"
 
-int main() {
-  System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) return 2;
+  // Before the descriptor cache sizes itself from the limit
+  ProcFileCache::RaiseDescriptorLimit();
+  int rows = options.rows == 0 ? 10 : static_cast<int>(options.rows);
+  if (options.mode == Options::Mode::kReplay) {
+    return NCursesDisplay::Replay(options.replay, rows);
+  }
+  if (!options.procRoot.empty() || !options.etcRoot.empty()) {
+    LinuxParser::SetRoots(
+        options.procRoot.empty() ? "/proc" : options.procRoot,
+        options.etcRoot.empty() ? "/etc" : options.etcRoot);
+  }
+  // Before System starts listening for process events
+  ProcessFilter filter;
+  std::string error;
+  if (!filter.Compile(options.filter, &error)) {
+    std::fprintf(stderr, "monitor: --filter: %s\n", error.c_str());
+    return 2;
+  }
+  // Process events describe the live system, not another proc tree
+  System system(options.threads, options.procRoot.empty());
+  system.AccurateMemory(options.accurateMemory);
+  system.Expand(options.expand);
+  system.GroupByCgroup(options.group);
+  system.FilterBy(std::move(filter));
+  if (options.mode == Options::Mode::kHeadless) {
+    return Headless::Run(system, options);
+  }
+  HistoryFile history;
+  if (!options.history.empty() &&
+      !history.Create(options.history, options.historySize)) {
+    std::fprintf(stderr, "monitor: %s: cannot create history file\n",
+                 options.history.c_str());
+    return 1;
+  }
+  auto renderInterval = options.renderInterval.count() > 0
+                            ? options.renderInterval
+                            : options.interval;
+  NCursesDisplay::Display(system, rows, options.interval, renderInterval,
+                          options.history.empty() ? nullptr : &history,
+                          options.sortKey, options.stallTrigger);
+}
@@ -1,110 +1,870 @@
 #include <curses.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 
 #include "format.h"
 #include "ncurses_display.h"
+#include "process_filter.h"
+#include "processor.h"
+#include "sampler.h"
 #include "system.h"
 
-using std::string;
-using std::to_string;
-
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
-std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
-  int size{50};
-  float bars{percent * size};
+void NCursesDisplay::ProgressBar(float percent, char* buffer,
+                                 std::size_t size) {
+  constexpr int kBars{50};
+  char bars[kBars + 1];
+  for (int i{0}; i < kBars; ++i) bars[i] = i <= percent * kBars ? '|' : ' ';
+  bars[kBars] = '\0';
+  float value = percent * 100;
+  if (value >= 99.95f) {
+    std::snprintf(buffer, size, "0%%%s  100/100%%", bars);
+  } else {
+    std::snprintf(buffer, size, "0%%%s %4.1f/100%%", bars, value);
+  }
+}
+
+// Per-core cells are "NNN[bar] " while they fit in a few rows; beyond that
+// every core is drawn as a single load glyph
+constexpr int kCoreBarWidth{8};
+constexpr int kCoreCellWidth{kCoreBarWidth + 6};
+constexpr int kMaxCoreBarRows{4};
+constexpr int kCoreLabelWidth{5};
+constexpr char kLoadGlyphs[]{" .:-=+*#%@"};
+// Widest row composed into a stack buffer
+constexpr int kMaxLine{512};
+// Threads listed under an expanded process, and members under an
+// expanded cgroup
+constexpr int kThreadRows{8};
+constexpr int kMemberRows{8};
+// Busiest network interfaces shown in the system window, and the width of
+// their rate bars
+constexpr int kNetworkRows{3};
+constexpr int kRateBarWidth{16};
 
-  for (int i{0}; i < size; ++i) {
-    result += i <= bars ? '|' : ' ';
+// Stall pressure is shown right of the CPU, memory and swap bars
+constexpr int kPressureColumn{76};
+
+// Draw the pressure of resource at kPressureColumn of the current row,
+// highlighted if it triggered the snapshot
+void PressureCell(const Snapshot& snapshot, PressureStats::Resource resource,
+                  Canvas& canvas) {
+  const PressureStats::Pressure& pressure = snapshot.pressure[resource];
+  int pair = snapshot.stallTriggered ? 3 : 1;
+  if (!pressure.available) {
+    canvas.Format(kPressureColumn, 0, "%-6s stall   n/a",
+                  PressureStats::Name(resource));
+    return;
   }
+  canvas.Format(kPressureColumn, pair, "%-6s stall some %5.1f%%  full %5.1f%%",
+                PressureStats::Name(resource),
+                pressure.some.interval * 100, pressure.full.interval * 100);
+}
+
+// Fill bar with rate as a share of peak
+void RateBar(float rate, float peak, char* bar) {
+  int filled = peak > 0 ? static_cast<int>(rate / peak * kRateBarWidth + 0.5f)
+                        : 0;
+  for (int i = 0; i < kRateBarWidth; ++i) bar[i] = i < filled ? '|' : ' ';
+  bar[kRateBarWidth] = '\0';
+}
+
+// Number of window rows the per-core grid needs for a given inner width
+int NCursesDisplay::CoreRows(std::size_t cores, int width) {
+  if (cores == 0 || width <= kCoreLabelWidth) return 0;
+  int cells = static_cast<int>(cores);
+  int perRow = std::max(1, width / kCoreCellWidth);
+  int rows = (cells + perRow - 1) / perRow;
+  if (rows <= kMaxCoreBarRows) return rows;
+  perRow = width - kCoreLabelWidth;
+  return (cells + perRow - 1) / perRow;
+}
+
+int NCursesDisplay::DisplayCores(const std::vector<float>& cores,
+                                 Canvas& canvas, int row) {
+  int width{std::min(canvas.Width() - 4, kMaxLine - 1)};
+  int cells = static_cast<int>(cores.size());
+  int perRow = std::max(1, width / kCoreCellWidth);
+  bool bars = (cells + perRow - 1) / perRow <= kMaxCoreBarRows;
+  if (!bars) perRow = std::max(1, width - kCoreLabelWidth);
 
-  string display{to_string(percent * 100).substr(0, 4)};
-  if (percent < 0.1 || percent == 1.0)
-    display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+  // Each grid row is composed into one line
+  char line[kMaxLine];
+  for (int first = 0; first < cells; first += perRow, ++row) {
+    int last = std::min(first + perRow, cells);
+    int length = 0;
+    if (!bars) length = std::snprintf(line, sizeof(line), "%3d ", first);
+    for (int i = first; i < last; ++i) {
+      float load = cores[i];
+      if (bars) {
+        char bar[kCoreBarWidth + 1];
+        if (load == Processor::kOffline) {
+          std::snprintf(bar, sizeof(bar), "%-*s", kCoreBarWidth, " off");
+        } else {
+          int filled = static_cast<int>(load * kCoreBarWidth + 0.5f);
+          for (int b = 0; b < kCoreBarWidth; ++b)
+            bar[b] = b < filled ? '|' : ' ';
+          bar[kCoreBarWidth] = '\0';
+        }
+        length += std::snprintf(line + length, sizeof(line) - length,
+                                "%3d[%s] ", i, bar);
+      } else {
+        int level = static_cast<int>(load * (sizeof(kLoadGlyphs) - 2) + 0.5f);
+        line[length++] =
+            load == Processor::kOffline ? '_' : kLoadGlyphs[level];
+      }
+    }
+    line[length] = '\0';
+    canvas.Begin(row);
+    canvas.Text(2, line, 1);
+    canvas.End();
+  }
+  return row;
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+void NCursesDisplay::DisplaySystem(const Snapshot& snapshot, Canvas& canvas) {
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
-  mvwprintw(window, ++row, 2, "CPU: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Memory: ");
-  wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
-  wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
-  wrefresh(window);
-}
-
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
+  char bar[128];
+  canvas.Begin(++row);
+  canvas.Format(2, 0, "OS: %s", snapshot.operatingSystem.c_str());
+  canvas.End();
+  canvas.Begin(++row);
+  canvas.Format(2, 0, "Kernel: %s", snapshot.kernel.c_str());
+  canvas.End();
+  canvas.Begin(++row);
+  canvas.Text(2, "CPU: ");
+  ProgressBar(snapshot.cpuUtilization, bar, sizeof(bar));
+  canvas.Text(10, bar, 1);
+  PressureCell(snapshot, PressureStats::kCpu, canvas);
+  canvas.End();
+  DisplayCores(snapshot.coreUtilization, canvas, row + 1);
+  row += CoreRows(snapshot.coreUtilization.size(), canvas.Width() - 4);
+  canvas.Begin(++row);
+  canvas.Text(2, "Memory: ");
+  ProgressBar(snapshot.memoryUtilization, bar, sizeof(bar));
+  canvas.Text(10, bar, 1);
+  PressureCell(snapshot, PressureStats::kMemory, canvas);
+  canvas.End();
+  canvas.Begin(++row);
+  canvas.Text(2, "Swap: ");
+  ProgressBar(snapshot.swapUtilization, bar, sizeof(bar));
+  canvas.Text(10, bar, 1);
+  PressureCell(snapshot, PressureStats::kIo, canvas);
+  canvas.End();
+  canvas.Begin(++row);
+  canvas.Format(2, 0, "Total Processes: %d  Load Average: %.2f %.2f %.2f",
+                snapshot.totalProcesses, snapshot.loadAverage[0],
+                snapshot.loadAverage[1], snapshot.loadAverage[2]);
+  canvas.End();
+  canvas.Begin(++row);
+  if (snapshot.processEvents) {
+    canvas.Format(2, 0,
+                  "Running Processes: %d  Blocked: %d  Exited: %d (%d "
+                  "short-lived, %.1f%% CPU)",
+                  snapshot.runningProcesses, snapshot.blockedProcesses,
+                  snapshot.exitedProcesses, snapshot.shortLivedProcesses,
+                  snapshot.exitedCpuUtilization * 100);
+  } else {
+    canvas.Format(2, 0, "Running Processes: %d  Blocked: %d",
+                  snapshot.runningProcesses, snapshot.blockedProcesses);
+  }
+  canvas.End();
+  char time[32];
+  Format::ElapsedTime(snapshot.upTime, time, sizeof(time));
+  canvas.Begin(++row);
+  canvas.Format(2, 0, "Up Time: %s", time);
+  canvas.End();
+  DisplayNetwork(snapshot.interfaces, canvas, row + 1);
+}
+
+int NCursesDisplay::DisplayNetwork(
+    const std::vector<NetStats::Interface>& interfaces, Canvas& canvas,
+    int row) {
+  canvas.Begin(row);
+  canvas.Text(2, "Net: ");
+  if (interfaces.empty()) canvas.Text(10, "idle", 1);
+  char rx[kRateBarWidth + 1], tx[kRateBarWidth + 1];
+  char rxRate[16], txRate[16];
+  int shown = std::min<int>(interfaces.size(), kNetworkRows);
+  for (int i = 0; i < kNetworkRows; ++i) {
+    if (i > 0) canvas.Begin(row + i);
+    if (i < shown) {
+      const NetStats::Interface& interface = interfaces[i];
+      RateBar(interface.rxRate, interface.peak, rx);
+      RateBar(interface.txRate, interface.peak, tx);
+      Format::Rate(interface.rxRate, rxRate, sizeof(rxRate));
+      Format::Rate(interface.txRate, txRate, sizeof(txRate));
+      canvas.Format(10, 1, "%-12.12s rx[%s] %s  tx[%s] %s",
+                    interface.name.c_str(), rx, rxRate, tx, txRate);
+      if (interface.errors > 0 || interface.drops > 0) {
+        canvas.Format(91, 3, "err %.0f/s drop %.0f/s", interface.errors,
+                      interface.drops);
+      }
+    }
+    canvas.End();
+  }
+  return row + kNetworkRows;
+}
+
+void NCursesDisplay::DisplayProcesses(const Snapshot& snapshot,
+                                      Canvas& canvas, int n, int selected) {
+  const ProcessTable& processes = snapshot.processes;
+  System::SortKey key = snapshot.sortKey;
   int row{0};
   int const pid_column{2};
   int const user_column{9};
   int const cpu_column{16};
-  int const ram_column{26};
-  int const time_column{35};
-  int const command_column{46};
-  wattron(window, COLOR_PAIR(2));
-  mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
-  mvwprintw(window, row, ram_column, "RAM[MB]");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
-  wattroff(window, COLOR_PAIR(2));
-  int const num_processes = int(processes.size()) > n ? n : processes.size();
-  for (int i = 0; i < num_processes; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 46).c_str());
-  }
-}
-
-void NCursesDisplay::Display(System& system, int n) {
+  int const rss_column{26};
+  int const memory_column{35};
+  int const io_column{44};
+  int const time_column{54};
+  int const command_column{65};
+  int const num_processes = std::min<int>(processes.size(), n);
+  // The second memory column shows PSS once it has been measured
+  bool pss{false};
+  for (int i = 0; i < num_processes; ++i) pss |= processes[i].Ram().accurate;
+  canvas.Begin(++row);
+  canvas.Text(pid_column, "PID", key == System::SortKey::kPid ? 3 : 2);
+  canvas.Text(user_column, "USER", 2);
+  canvas.Text(cpu_column, "CPU[%]", key == System::SortKey::kCpu ? 3 : 2);
+  canvas.Text(rss_column, "RES[MB]", key == System::SortKey::kMemory ? 3 : 2);
+  canvas.Text(memory_column, pss ? "PSS[MB]" : "SHR[MB]", 2);
+  canvas.Text(io_column, "IO[KB/s]", key == System::SortKey::kIo ? 3 : 2);
+  canvas.Text(time_column, "TIME+", key == System::SortKey::kTime ? 3 : 2);
+  canvas.Text(command_column, "COMMAND", 2);
+  canvas.End();
+  char time[32];
+  // The header is row 1, so rows 2 to n + 1 hold processes and threads
+  for (int i = 0; i < num_processes && row <= n; ++i) {
+    Process process = processes[i];
+    int pair = process.Pid() == selected ? 3 : 0;
+    float cpu = process.CpuUtilization() * 100;
+    Format::ElapsedTime(process.UpTime(), time, sizeof(time));
+    canvas.Begin(++row);
+    canvas.Format(pid_column, pair, "%-6d", process.Pid());
+    canvas.Text(user_column, process.User(), pair);
+    canvas.Format(cpu_column, pair,
+                  cpu < 10 ? "%.2f" : cpu < 100 ? "%.1f" : "%.0f", cpu);
+    Process::Memory ram = process.Ram();
+    canvas.Format(rss_column, pair, "%llu",
+                  static_cast<unsigned long long>(ram.rssKb / 1024));
+    canvas.Format(memory_column, pair, "%llu",
+                  static_cast<unsigned long long>(
+                      (pss ? ram.pssKb : ram.sharedKb) / 1024));
+    Process::Io io = process.DiskIo();
+    if (io.known) {
+      canvas.Format(io_column, pair, "%.0f",
+                    (io.readRate + io.writeRate) / 1024);
+    } else {
+      canvas.Text(io_column, "-", pair);
+    }
+    canvas.Text(time_column, time, pair);
+    canvas.Text(command_column, process.Command(), pair);
+    canvas.End();
+
+    // Busiest threads of an expanded process, beneath it
+    int shown{0};
+    for (const auto& thread : snapshot.threads) {
+      if (thread.pid != process.Pid()) continue;
+      if (shown++ == kThreadRows || row > n) break;
+      float load = thread.cpuUtilization * 100;
+      canvas.Begin(++row);
+      canvas.Format(pid_column, 1, "%d", thread.tid);
+      canvas.Format(cpu_column, 1,
+                    load < 10 ? "%.2f" : load < 100 ? "%.1f" : "%.0f", load);
+      canvas.Format(command_column, 1, "`- %s (%c)", thread.name,
+                    thread.state);
+      canvas.End();
+    }
+  }
+  canvas.ClearFrom(row + 1);
+}
+
+void NCursesDisplay::DisplayGroups(const Snapshot& snapshot, Canvas& canvas,
+                                   int n, int selected) {
+  System::SortKey key = snapshot.sortKey;
+  int row{0};
+  int const procs_column{2};
+  int const cpu_column{9};
+  int const memory_column{18};
+  int const io_column{28};
+  int const stall_column{38};
+  int const path_column{48};
+  canvas.Begin(++row);
+  if (!snapshot.cgroupsAvailable) {
+    canvas.Text(procs_column, "No cgroup v2 hierarchy to group by", 3);
+    canvas.End();
+    canvas.ClearFrom(row + 1);
+    return;
+  }
+  canvas.Text(procs_column, "PROCS", 2);
+  canvas.Text(cpu_column, "CPU[%]", key == System::SortKey::kCpu ? 3 : 2);
+  canvas.Text(memory_column, "MEM[MB]",
+              key == System::SortKey::kMemory ? 3 : 2);
+  canvas.Text(io_column, "IO[KB/s]", key == System::SortKey::kIo ? 3 : 2);
+  canvas.Text(stall_column, "STALL[%]", 2);
+  canvas.Text(path_column, "CGROUP", 2);
+  canvas.End();
+  for (const auto& group : snapshot.groups) {
+    // Rows 2 to n + 1 hold groups and members, as with processes
+    if (row > n) break;
+    int pair = group.id == selected ? 3 : 0;
+    float cpu = group.cpuUtilization * 100;
+    canvas.Begin(++row);
+    canvas.Format(procs_column, pair, "%d", group.processes);
+    canvas.Format(cpu_column, pair,
+                  cpu < 10 ? "%.2f" : cpu < 100 ? "%.1f" : "%.0f", cpu);
+    if (group.memoryKnown) {
+      canvas.Format(memory_column, pair, "%llu",
+                    static_cast<unsigned long long>(group.memoryBytes >> 20));
+    } else {
+      canvas.Text(memory_column, "-", pair);
+    }
+    if (group.ioKnown) {
+      canvas.Format(io_column, pair, "%.0f",
+                    (group.readRate + group.writeRate) / 1024);
+    } else {
+      canvas.Text(io_column, "-", pair);
+    }
+    if (group.stallKnown) {
+      canvas.Format(stall_column, pair, "%.1f", group.cpuStall * 100);
+    } else {
+      canvas.Text(stall_column, "-", pair);
+    }
+    canvas.Text(path_column, group.path.c_str(), pair);
+    canvas.End();
+
+    // Busiest members of an expanded group, beneath it
+    int shown{0};
+    for (const Process& process : snapshot.processes) {
+      if (!std::binary_search(group.members.begin(), group.members.end(),
+                              process.Pid()))
+        continue;
+      if (shown++ == kMemberRows || row > n) break;
+      float load = process.CpuUtilization() * 100;
+      canvas.Begin(++row);
+      canvas.Format(procs_column, 1, "%d", process.Pid());
+      canvas.Format(cpu_column, 1,
+                    load < 10 ? "%.2f" : load < 100 ? "%.1f" : "%.0f", load);
+      canvas.Format(memory_column, 1, "%llu",
+                    static_cast<unsigned long long>(process.Ram().rssKb /
+                                                    1024));
+      canvas.Format(path_column, 1, "`- %s", process.Command());
+      canvas.End();
+    }
+  }
+  canvas.ClearFrom(row + 1);
+}
+
+void NCursesDisplay::DisplayDisks(
+    const std::vector<DiskStats::Device>& disks, Canvas& canvas) {
+  int row{0};
+  canvas.Begin(++row);
+  canvas.Text(2, "DEVICE        READ[MB/s]  WRITE[MB/s]      IOPS  UTIL[%]",
+              2);
+  canvas.End();
+  for (const auto& disk : disks) {
+    canvas.Begin(++row);
+    canvas.Format(2, 0, "%-12.12s %11.2f %12.2f %9.0f %8.1f",
+                  disk.name.c_str(), disk.readRate / (1024 * 1024),
+                  disk.writeRate / (1024 * 1024), disk.iops,
+                  disk.utilization * 100);
+    canvas.End();
+  }
+  canvas.ClearFrom(row + 1);
+}
+
+void NCursesDisplay::DisplayInstrumentation(
+    const std::vector<Instrument::PhaseStats>& phases, Canvas& canvas) {
+  int row{0};
+  canvas.Begin(++row);
+  canvas.Text(2,
+              "PHASE      LAST[ms]  P50[ms]  P99[ms]  SYSCALLS       BYTES  "
+              "ALLOCS  PROCS",
+              2);
+  canvas.End();
+  for (const auto& phase : phases) {
+    canvas.Begin(++row);
+    canvas.Format(2, 0, "%-9s %9.2f %8.2f %8.2f %9llu %11llu %7llu %6llu",
+                  Instrument::Name(phase.phase), phase.lastUs / 1000.0,
+                  phase.p50Us / 1000.0, phase.p99Us / 1000.0,
+                  static_cast<unsigned long long>(phase.counters[0]),
+                  static_cast<unsigned long long>(phase.counters[1]),
+                  static_cast<unsigned long long>(phase.counters[2]),
+                  static_cast<unsigned long long>(phase.counters[3]));
+    canvas.End();
+  }
+  canvas.ClearFrom(row + 1);
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Screen {
+  Canvas system;
+  // Left out when no block device has done any I/O
+  Canvas disks;
+  Canvas processes;
+  // Optional status line, for the replay position or the filter and
+  // search prompts, and instrumentation footer
+  Canvas status;
+  Canvas footer;
+  std::size_t cores = 0;
+  std::size_t devices = 0;
+};
+
+void StartCurses() {
   initscr();      // start ncurses
   noecho();       // do not print input values
   cbreak();       // terminate ncurses on ctrl + c
   start_color();  // enable color
+  init_pair(1, COLOR_BLUE, COLOR_BLACK);
+  init_pair(2, COLOR_GREEN, COLOR_BLACK);
+  init_pair(3, COLOR_BLACK, COLOR_GREEN);
+  keypad(stdscr, true);
+  curs_set(0);
+  // Esc cancels a prompt without waiting long for an escape sequence
+  set_escdelay(25);
+}
 
-  int x_max{getmaxx(stdscr)};
-  WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
-  WINDOW* process_window =
-      newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
+// Size the windows to the terminal, for the cores and disks of snapshot
+// and n process rows; windows past the bottom of the terminal are left out
+void Layout(Screen& screen, const Snapshot& snapshot, int n, bool footer,
+            bool status) {
+  // Drop whatever the old layout left on screen
+  erase();
+  wnoutrefresh(stdscr);
+  std::size_t cores{snapshot.coreUtilization.size()};
+  std::size_t disks{snapshot.disks.size()};
+  int width{COLS - 1};
+  int core_rows{NCursesDisplay::CoreRows(cores, width - 4)};
+  int y{0};
+  int system_rows{10 + kNetworkRows + core_rows};
+  screen.system.Create(system_rows, width, y, 0);
+  y += system_rows;
+  if (disks > 0) {
+    screen.disks.Create(3 + static_cast<int>(disks), width, y, 0);
+    y += 3 + static_cast<int>(disks);
+  } else {
+    screen.disks.Destroy();
+  }
+  screen.processes.Create(3 + n, width, y, 0);
+  y += 3 + n;
+  if (status) {
+    screen.status.Create(1, width, y, 0, false);
+    y += 1;
+  } else {
+    screen.status.Destroy();
+  }
+  if (footer) {
+    screen.footer.Create(3 + static_cast<int>(Instrument::kPhases), width, y,
+                         0);
+  } else {
+    screen.footer.Destroy();
+  }
+  screen.cores = cores;
+  screen.devices = disks;
+}
+
+// True if the windows no longer match the shape of snapshot
+bool Reshaped(const Screen& screen, const Snapshot& snapshot) {
+  return snapshot.coreUtilization.size() != screen.cores ||
+         snapshot.disks.size() != screen.devices;
+}
+
+// Return the pid, or the group id when grouped, delta rows away from
+// selected among the first n; a selection that scrolled out of the list
+// starts over at the top
+int MoveSelection(const Snapshot& snapshot, int n, int selected, int delta) {
+  std::vector<int> ids;
+  if (snapshot.grouped) {
+    for (const auto& group : snapshot.groups) ids.push_back(group.id);
+  } else {
+    for (const Process& process : snapshot.processes)
+      ids.push_back(process.Pid());
+  }
+  int count = std::min<int>(ids.size(), n);
+  if (count == 0) return 0;
+  int index = -1;
+  for (int i = 0; i < count; ++i) {
+    if (ids[i] == selected) index = i;
+  }
+  index = index < 0 ? 0 : std::clamp(index + delta, 0, count - 1);
+  return ids[index];
+}
+
+// Return the pid, or the group id when grouped, of the first of the first
+// n rows whose command or user, or cgroup path, contains text regardless
+// of case; the search starts after the row of after and wraps around.
+// Return 0 if no row matches.
+int Search(const Snapshot& snapshot, int n, const std::string& text,
+           int after = 0) {
+  std::vector<int> ids;
+  std::vector<bool> matches;
+  auto contains = [&text](const char* field) {
+    return strcasestr(field, text.c_str()) != nullptr;
+  };
+  if (snapshot.grouped) {
+    for (const auto& group : snapshot.groups) {
+      ids.push_back(group.id);
+      matches.push_back(contains(group.path.c_str()));
+    }
+  } else {
+    for (const Process& process : snapshot.processes) {
+      ids.push_back(process.Pid());
+      matches.push_back(contains(process.Command()) ||
+                        contains(process.User()));
+    }
+  }
+  int count = std::min<int>(ids.size(), n);
+  int start = 0;
+  for (int i = 0; i < count; ++i) {
+    if (ids[i] == after) start = i + 1;
+  }
+  for (int i = 0; i < count; ++i) {
+    int index = (start + i) % count;
+    if (matches[index]) return ids[index];
+  }
+  return 0;
+}
+
+// Sort columns in the order '<' and '>' step through them
+constexpr System::SortKey kSortColumns[]{
+    System::SortKey::kPid, System::SortKey::kCpu, System::SortKey::kMemory,
+    System::SortKey::kIo, System::SortKey::kTime};
+
+// Return the sort column delta columns away from key, wrapping around
+System::SortKey NextSortKey(System::SortKey key, int delta) {
+  constexpr int kCount = sizeof(kSortColumns) / sizeof(kSortColumns[0]);
+  int index = std::find(kSortColumns, kSortColumns + kCount, key) -
+              kSortColumns;
+  return kSortColumns[(index + delta + kCount) % kCount];
+}
+
+// Line being typed into the status line
+struct Prompt {
+  enum class Kind { kNone, kFilter, kSearch };
+  Kind kind = Kind::kNone;
+  std::string text = {};
+  // Why the filter didn't compile
+  std::string error = {};
+};
+
+// Draw the open prompt, or else the filter in effect, the last search and
+// how many snapshots the history file missed
+void DrawStatus(Canvas& canvas, const Snapshot& snapshot,
+                const Prompt& prompt, const std::string& search, bool found,
+                uint64_t unrecorded) {
+  canvas.Begin(0);
+  if (prompt.kind == Prompt::Kind::kFilter) {
+    canvas.Format(1, 2, "Filter: %s_", prompt.text.c_str());
+    if (!prompt.error.empty()) {
+      canvas.Format(11 + static_cast<int>(prompt.text.size()), 3, "%s",
+                    prompt.error.c_str());
+    }
+  } else if (prompt.kind == Prompt::Kind::kSearch) {
+    canvas.Format(1, 2, "Search: %s_", prompt.text.c_str());
+    if (!found && !prompt.text.empty())
+      canvas.Text(11 + static_cast<int>(prompt.text.size()), "no match", 3);
+  } else {
+    std::string line;
+    if (!snapshot.filter.empty()) {
+      line = "Filter: " + snapshot.filter + " (" +
+             std::to_string(snapshot.matchingProcesses) + " matching)  ";
+    }
+    if (!search.empty()) line += "Search: " + search + " (n: next)  ";
+    canvas.Text(1, line.c_str());
+    if (unrecorded > 0) {
+      canvas.Format(1 + static_cast<int>(line.size()), 3,
+                    "History: %llu snapshots not recorded",
+                    static_cast<unsigned long long>(unrecorded));
+    }
+  }
+  canvas.End();
+}
+
+// Draw a frame and write out all changes in one go
+void Draw(Screen& screen, const Snapshot& snapshot, int n,
+          std::vector<Instrument::PhaseStats>& phases, int selected = 0) {
+  INSTRUMENT_SCOPE(kDraw);
+  NCursesDisplay::DisplaySystem(snapshot, screen.system);
+  if (screen.disks.Valid()) {
+    NCursesDisplay::DisplayDisks(snapshot.disks, screen.disks);
+    screen.disks.Stage();
+  }
+  if (snapshot.grouped) {
+    NCursesDisplay::DisplayGroups(snapshot, screen.processes, n, selected);
+  } else {
+    NCursesDisplay::DisplayProcesses(snapshot, screen.processes, n, selected);
+  }
+  screen.system.Stage();
+  screen.processes.Stage();
+  if (screen.footer.Valid()) {
+    Instrument::Read(phases);
+    NCursesDisplay::DisplayInstrumentation(phases, screen.footer);
+    screen.footer.Stage();
+  }
+  screen.status.Stage();
+  doupdate();
+}
+}  // namespace
+
+void NCursesDisplay::Display(System& system, int n,
+                             std::chrono::milliseconds samplePeriod,
+                             std::chrono::milliseconds renderPeriod,
+                             HistoryFile* history, System::SortKey sortKey,
+                             std::chrono::microseconds stallTrigger) {
+  Sampler sampler(system, n, samplePeriod, history);
+  sampler.SortBy(sortKey);
+  if (stallTrigger.count() > 0 && !sampler.WakeOnStall(stallTrigger)) {
+    std::fprintf(stderr, "monitor: cannot arm PSI triggers\n");
+  }
+  sampler.Start();
+
+  StartCurses();
+  nodelay(stdscr, true);
+  Screen screen;
+  bool footer{false};
+  const Snapshot* snapshot = &sampler.Latest();
+  std::vector<Instrument::PhaseStats> phases;
+  int selected{0};
+  Prompt prompt;
+  // Last search, repeated by 'n', and whether it matched
+  std::string search;
+  bool found{false};
+  bool status{!snapshot->filter.empty()};
+  Layout(screen, *snapshot, n, footer, status);
+  std::vector<int> expanded{system.Expanded()};
+  // Selection and expansion refer to group ids while grouped
+  bool grouped{system.Grouped()};
+  std::vector<int> expandedGroups;
+
+  // Wait for keys and new snapshots at the same time
+  pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0},
+                   {sampler.NotifyFd(), POLLIN, 0}};
+  uint64_t drawn{0};
+  bool dirty{true};
+  Clock::time_point lastFrame{};
+  while (true) {
+    bool quit{false};
+    bool relayout{false};
+    for (int key; (key = getch()) != ERR;) {
+      // An open prompt takes the keys that edit it
+      if (prompt.kind != Prompt::Kind::kNone) {
+        bool searching = prompt.kind == Prompt::Kind::kSearch;
+        bool edited{false};
+        if (key == 27) {
+          if (searching) search.clear();
+          prompt = {};
+        } else if (key == '\n' || key == KEY_ENTER) {
+          if (searching) {
+            prompt = {};
+          } else {
+            ProcessFilter filter;
+            if (filter.Compile(prompt.text, &prompt.error)) {
+              // Takes effect with the next snapshot
+              sampler.FilterBy(std::move(filter));
+              prompt = {};
+            }
+          }
+        } else if (key == KEY_BACKSPACE || key == 127 || key == '\b') {
+          if (!prompt.text.empty()) prompt.text.pop_back();
+          edited = true;
+        } else if (key >= ' ' && key <= '~') {
+          prompt.text += static_cast<char>(key);
+          edited = true;
+        } else if (key != KEY_RESIZE) {
+          continue;
+        }
+        if (edited) prompt.error.clear();
+        if (edited && searching) {
+          // Jump to the first match as the text is typed
+          search = prompt.text;
+          int match = Search(*snapshot, n, search);
+          found = match != 0;
+          if (found) selected = match;
+        }
+        dirty = true;
+        if (key != KEY_RESIZE) continue;
+      }
+      if (key == 'q' || key == 'Q') {
+        quit = true;
+      } else if (key == 'm' || key == 'o') {
+        // Toggles between CPU and the key; takes effect with the next
+        // snapshot
+        auto toggled = key == 'm' ? System::SortKey::kMemory
+                                  : System::SortKey::kIo;
+        sortKey = sortKey == toggled ? System::SortKey::kCpu : toggled;
+        sampler.SortBy(sortKey);
+      } else if (key == '<' || key == '>') {
+        sortKey = NextSortKey(sortKey, key == '<' ? -1 : 1);
+        sampler.SortBy(sortKey);
+      } else if (key == 'f') {
+        prompt.kind = Prompt::Kind::kFilter;
+        prompt.text = snapshot->filter;
+        dirty = true;
+      } else if (key == '/') {
+        prompt.kind = Prompt::Kind::kSearch;
+        search.clear();
+        found = false;
+        dirty = true;
+      } else if (key == 27 && !search.empty()) {
+        search.clear();
+        dirty = true;
+      } else if (key == 'n' && !search.empty()) {
+        int match = Search(*snapshot, n, search, selected);
+        found = match != 0;
+        if (found) selected = match;
+        dirty = true;
+      } else if (key == KEY_UP || key == KEY_DOWN) {
+        selected =
+            MoveSelection(*snapshot, n, selected, key == KEY_UP ? -1 : 1);
+        dirty = true;
+      } else if ((key == '\n' || key == KEY_ENTER || key == 't') &&
+                 selected != 0) {
+        std::vector<int>& ids = grouped ? expandedGroups : expanded;
+        auto it = std::find(ids.begin(), ids.end(), selected);
+        if (it == ids.end()) {
+          ids.push_back(selected);
+        } else {
+          ids.erase(it);
+        }
+        // Threads and members show up with the next snapshot
+        if (grouped) {
+          sampler.GroupByCgroup(true, expandedGroups);
+        } else {
+          sampler.Expand(expanded);
+        }
+      } else if (key == 'g') {
+        grouped = !grouped;
+        expandedGroups.clear();
+        selected = 0;
+        sampler.GroupByCgroup(grouped);
+        dirty = true;
+      } else if (key == 'i' && Instrument::kEnabled) {
+        footer = !footer;
+        relayout = true;
+      } else if (key == KEY_RESIZE) {
+        relayout = true;
+      }
+    }
+    if (quit) break;
+
+    snapshot = &sampler.Latest();
+    // The status line is shown while there is something to show in it
+    uint64_t unrecorded = sampler.Unrecorded();
+    bool shown = prompt.kind != Prompt::Kind::kNone ||
+                 !snapshot->filter.empty() || !search.empty() ||
+                 unrecorded > 0;
+    if (relayout || shown != status || Reshaped(screen, *snapshot)) {
+      status = shown;
+      Layout(screen, *snapshot, n, footer, status);
+      dirty = true;
+    }
+    // A new snapshot is drawn once the minimum frame interval has passed,
+    // input is answered right away
+    int timeout{-1};
+    auto now = Clock::now();
+    // Stall samples are drawn right away too
+    bool due = now - lastFrame >= renderPeriod || snapshot->stallTriggered;
+    if (dirty || (snapshot->tick != drawn && due)) {
+      if (status) {
+        DrawStatus(screen.status, *snapshot, prompt, search, found,
+                   unrecorded);
+      }
+      Draw(screen, *snapshot, n, phases, selected);
+      drawn = snapshot->tick;
+      lastFrame = now;
+      dirty = false;
+    } else if (snapshot->tick != drawn) {
+      timeout = static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              lastFrame + renderPeriod - now)
+              .count() +
+          1);
+    }
+
+    fds[0].revents = fds[1].revents = 0;
+    if (poll(fds, fds[1].fd >= 0 ? 2 : 1, timeout) > 0 &&
+        (fds[1].revents & POLLIN)) {
+      uint64_t count;
+      [[maybe_unused]] ssize_t bytes = read(fds[1].fd, &count, sizeof(count));
+    }
+  }
+  endwin();
+}
+
+int NCursesDisplay::Replay(const std::string& path, int n) {
+  HistoryFile history;
+  Snapshot snapshot;
+  if (!history.Open(path) || history.Load() == 0 ||
+      !history.Read(0, snapshot)) {
+    std::fprintf(stderr, "monitor: %s: no recorded history\n", path.c_str());
+    return 1;
+  }
+  std::size_t count = history.Count();
+  std::size_t position = count - 1;
+  history.Read(position, snapshot);
+
+  StartCurses();
+  Screen screen;
+  Layout(screen, snapshot, n, false, true);
+  std::vector<Instrument::PhaseStats> phases;
 
   while (1) {
-    init_pair(1, COLOR_BLUE, COLOR_BLACK);
-    init_pair(2, COLOR_GREEN, COLOR_BLACK);
-    box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
-    wrefresh(system_window);
-    wrefresh(process_window);
-    refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    char when[32] = "";
+    std::time_t seconds = snapshot.time / 1000;
+    std::tm local;
+    if (localtime_r(&seconds, &local) != nullptr)
+      std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local);
+    screen.status.Begin(0);
+    screen.status.Format(1, 0,
+                         "Replay %zu/%zu  %s  (left/right: step, PgUp/PgDn: "
+                         "60, Home/End, q: quit)",
+                         position + 1, count, when);
+    screen.status.End();
+    Draw(screen, snapshot, n, phases);
+
+    std::size_t target = position;
+    int key = getch();
+    if (key == 'q' || key == 'Q' || key == ERR) break;
+    switch (key) {
+      case KEY_LEFT:
+        target = position > 0 ? position - 1 : 0;
+        break;
+      case KEY_RIGHT:
+        target = std::min(position + 1, count - 1);
+        break;
+      case KEY_PPAGE:
+        target = position > 60 ? position - 60 : 0;
+        break;
+      case KEY_NPAGE:
+        target = std::min(position + 60, count - 1);
+        break;
+      case KEY_HOME:
+        target = 0;
+        break;
+      case KEY_END:
+        target = count - 1;
+        break;
+      case KEY_RESIZE:
+        Layout(screen, snapshot, n, false, true);
+        break;
+    }
+    if (target != position && history.Read(target, snapshot))
+      position = target;
+    if (Reshaped(screen, snapshot)) Layout(screen, snapshot, n, false, true);
   }
   endwin();
+  return 0;
 }
@@ -0,0 +1,157 @@
+#include "net_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "proc_file_cache.h"
+
+namespace {
+// Columns of the counters that are kept, in the order of NetStats::Counter:
+// receive bytes, packets, errs and drop, then the same four for transmit
+constexpr int kColumns[] = {0, 1, 2, 3, 8, 9, 10, 11};
+constexpr int kLastColumn = 11;
+
+// Counters of 32-bit kernels wrap at 2^32, from within this much of the
+// top of the range to within this much of zero
+constexpr uint64_t kWrapWindow = uint64_t{1} << 30;
+
+// True if a counter went from before to now by wrapping at 2^32; any other
+// decrease means the interface was recreated and its counters started over
+bool Wrapped(uint64_t now, uint64_t before) {
+  return now < before && before <= UINT32_MAX &&
+         before > UINT32_MAX - kWrapWindow && now < kWrapWindow;
+}
+
+uint64_t Delta(uint64_t now, uint64_t before) {
+  if (now >= before) return now - before;
+  return now + (uint64_t{1} << 32) - before;
+}
+
+// Return items[count], appending it if needed; the strings of reused
+// elements keep their capacity
+template <typename T>
+T& Slot(std::vector<T>& items, std::size_t count) {
+  if (items.size() <= count) items.emplace_back();
+  return items[count];
+}
+}  // namespace
+
+std::size_t NetStats::Find(const char* name, std::size_t length,
+                           std::size_t hint) const {
+  auto matches = [&](const State& state) {
+    return state.name.size() == length &&
+           std::memcmp(state.name.data(), name, length) == 0;
+  };
+  if (hint < states_.size() && matches(states_[hint])) return hint;
+  for (std::size_t i = 0; i < states_.size(); ++i) {
+    if (matches(states_[i])) return i;
+  }
+  return states_.size();
+}
+
+bool NetStats::Read(double elapsed) {
+  std::size_t states = 0;
+  std::size_t active = 0;
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kNetDev,
+                                     buffer_)) {
+    interfaces_.clear();
+    return false;
+  }
+  std::size_t hint = 0;
+  const char* p = buffer_.c_str();
+  while (*p != '\0') {
+    const char* eol = std::strchr(p, '\n');
+    if (eol == nullptr) eol = p + std::strlen(p);
+    const char* colon =
+        static_cast<const char*>(std::memchr(p, ':', eol - p));
+    const char* line = p;
+    p = *eol == '\0' ? eol : eol + 1;
+    // The two header lines have no colon
+    if (colon == nullptr) continue;
+    while (*line == ' ') ++line;
+    auto length = static_cast<std::size_t>(colon - line);
+    auto textLength = static_cast<std::size_t>(eol - colon - 1);
+
+    std::size_t index = Find(line, length, hint);
+    const State* previous =
+        index < states_.size() ? &states_[index] : nullptr;
+    if (previous != nullptr) hint = index + 1;
+    State& state = Slot(next_, states++);
+    state.name.assign(line, length);
+    bool idle = previous != nullptr && previous->line.size() == textLength &&
+                std::memcmp(previous->line.data(), colon + 1, textLength) == 0;
+    if (idle) {
+      std::copy(std::begin(previous->counters), std::end(previous->counters),
+                std::begin(state.counters));
+      state.peak = previous->peak;
+      // The previous line is still equal to this one
+      state.line = previous->line;
+      continue;
+    }
+    state.line.assign(colon + 1, textLength);
+
+    const char* field = colon + 1;
+    int counter = 0;
+    for (int column = 0; column <= kLastColumn; ++column) {
+      char* end;
+      unsigned long long value = std::strtoull(field, &end, 10);
+      if (end == field) break;
+      field = end;
+      if (column == kColumns[counter]) state.counters[counter++] = value;
+    }
+    if (counter != kCounters) {
+      --states;
+      continue;
+    }
+    state.peak = previous != nullptr ? previous->peak : 0.0f;
+    if (previous == nullptr || elapsed <= 0) continue;
+
+    // A recreated interface has no rate this tick, and its peak belonged
+    // to the old one
+    bool reset = false;
+    for (int i = 0; i < kCounters; ++i) {
+      reset = reset || (state.counters[i] < previous->counters[i] &&
+                        !Wrapped(state.counters[i], previous->counters[i]));
+    }
+    if (reset) {
+      state.peak = 0.0f;
+      continue;
+    }
+    uint64_t delta[kCounters];
+    bool moved = false;
+    for (int i = 0; i < kCounters; ++i) {
+      delta[i] = Delta(state.counters[i], previous->counters[i]);
+      moved = moved || delta[i] != 0;
+    }
+    if (!moved) continue;
+    auto rate = [elapsed](uint64_t count) {
+      return static_cast<float>(count / elapsed);
+    };
+    Interface& interface = Slot(interfaces_, active++);
+    interface.name = state.name;
+    interface.rxRate = rate(delta[kRxBytes]);
+    interface.txRate = rate(delta[kTxBytes]);
+    interface.rxPackets = rate(delta[kRxPackets]);
+    interface.txPackets = rate(delta[kTxPackets]);
+    interface.errors = rate(delta[kRxErrors] + delta[kTxErrors]);
+    interface.drops = rate(delta[kRxDrops] + delta[kTxDrops]);
+    state.peak = std::max({state.peak, interface.rxRate, interface.txRate});
+    interface.peak = state.peak;
+  }
+  next_.resize(states);
+  std::swap(states_, next_);
+  interfaces_.resize(active);
+  std::sort(interfaces_.begin(), interfaces_.end(),
+            [](const Interface& a, const Interface& b) {
+              return a.rxRate + a.txRate > b.rxRate + b.txRate;
+            });
+  return true;
+}
+
+const std::vector<NetStats::Interface>& NetStats::Interfaces() const {
+  return interfaces_;
+}
@@ -0,0 +1,156 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+const char kUsage[] =
+    "usage: monitor [options]\n"
+    "  --headless            stream snapshots instead of drawing the UI\n"
+    "  --format=ndjson|binary  headless output format (default ndjson)\n"
+    "  --output=PATH         headless output file (default stdout)\n"
+    "  --interval=SECONDS    sampling interval, may be fractional "
+    "(default 1)\n"
+    "  --render-interval=SECONDS  minimum time between UI frames\n"
+    "                        (default: the sampling interval)\n"
+    "  --rows=N              processes per snapshot, 0 for all (default 10)\n"
+    "  --count=N             stop after N snapshots (default: run forever)\n"
+    "  --threads=N           /proc collection threads, 0 for one per CPU\n"
+    "  --sort=cpu|memory|io|pid|time  rank processes by CPU, resident\n"
+    "                        memory, storage I/O, pid or start time\n"
+    "  --filter=TEXT         only report processes matching all terms of\n"
+    "                        TEXT: user:NAME, re:REGEX or a substring\n"
+    "  --accurate-memory     also report PSS and swap from smaps_rollup\n"
+    "  --expand=PID[,PID...]  report the threads of these processes\n"
+    "  --group               report totals per cgroup v2 (container)\n"
+    "  --stall-trigger=MS    also sample as soon as tasks stall on CPU,\n"
+    "                        memory or I/O for MS ms within 2 s (PSI)\n"
+    "  --history=PATH        record snapshots to a ring buffer file\n"
+    "  --history-size=MB     size of a new history file (default 64)\n"
+    "  --replay=PATH         browse a recorded history file\n"
+    "  --proc-root=DIR       read processes from DIR instead of /proc\n"
+    "  --etc-root=DIR        read os-release and passwd from DIR\n";
+
+// Return the value of "--name=value" if arg is that option
+const char* Value(const char* arg, const char* name) {
+  std::size_t length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+    return nullptr;
+  return arg + length + 1;
+}
+
+// Parse a comma separated list of PIDs
+bool ParsePids(const char* text, std::vector<int>& pids) {
+  pids.clear();
+  while (true) {
+    char* end;
+    long pid = std::strtol(text, &end, 10);
+    if (end == text || pid <= 0) return false;
+    pids.push_back(static_cast<int>(pid));
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    text = end + 1;
+  }
+}
+
+// Parse a positive, possibly fractional number of seconds
+bool ParseSeconds(const char* text, std::chrono::milliseconds& value) {
+  char* end;
+  double seconds = std::strtod(text, &end);
+  if (*text == '\0' || *end != '\0' || !(seconds >= 0.001)) return false;
+  value =
+      std::chrono::milliseconds(static_cast<long>(seconds * 1000 + 0.5));
+  return true;
+}
+
+bool ParseCount(const char* text, std::size_t& value) {
+  char* end;
+  unsigned long long parsed = std::strtoull(text, &end, 10);
+  if (*text == '\0' || *end != '\0' || *text == '-') return false;
+  value = static_cast<std::size_t>(parsed);
+  return true;
+}
+}  // namespace
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value;
+    bool ok = true;
+    if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+      std::fputs(kUsage, stdout);
+      std::exit(0);
+    } else if (std::strcmp(arg, "--headless") == 0) {
+      options.mode = Options::Mode::kHeadless;
+    } else if ((value = Value(arg, "--format"))) {
+      if (std::strcmp(value, "ndjson") == 0) {
+        options.format = Options::Format::kNdjson;
+      } else if (std::strcmp(value, "binary") == 0) {
+        options.format = Options::Format::kBinary;
+      } else {
+        ok = false;
+      }
+    } else if ((value = Value(arg, "--output"))) {
+      options.output = value;
+    } else if ((value = Value(arg, "--interval"))) {
+      ok = ParseSeconds(value, options.interval);
+    } else if ((value = Value(arg, "--render-interval"))) {
+      ok = ParseSeconds(value, options.renderInterval);
+    } else if ((value = Value(arg, "--rows"))) {
+      ok = ParseCount(value, options.rows);
+    } else if ((value = Value(arg, "--count"))) {
+      ok = ParseCount(value, options.count);
+    } else if ((value = Value(arg, "--threads"))) {
+      ok = ParseCount(value, options.threads);
+    } else if ((value = Value(arg, "--sort"))) {
+      if (std::strcmp(value, "cpu") == 0) {
+        options.sortKey = System::SortKey::kCpu;
+      } else if (std::strcmp(value, "memory") == 0) {
+        options.sortKey = System::SortKey::kMemory;
+      } else if (std::strcmp(value, "io") == 0) {
+        options.sortKey = System::SortKey::kIo;
+      } else if (std::strcmp(value, "pid") == 0) {
+        options.sortKey = System::SortKey::kPid;
+      } else if (std::strcmp(value, "time") == 0) {
+        options.sortKey = System::SortKey::kTime;
+      } else {
+        ok = false;
+      }
+    } else if ((value = Value(arg, "--filter"))) {
+      options.filter = value;
+    } else if (std::strcmp(arg, "--accurate-memory") == 0) {
+      options.accurateMemory = true;
+    } else if (std::strcmp(arg, "--group") == 0) {
+      options.group = true;
+    } else if ((value = Value(arg, "--expand"))) {
+      ok = ParsePids(value, options.expand);
+    } else if ((value = Value(arg, "--stall-trigger"))) {
+      std::size_t milliseconds = 0;
+      // The kernel wants a threshold below the window
+      ok = ParseCount(value, milliseconds) && milliseconds > 0 &&
+           std::chrono::milliseconds(milliseconds) < StallTriggers::kWindow;
+      options.stallTrigger = std::chrono::milliseconds(milliseconds);
+    } else if ((value = Value(arg, "--history"))) {
+      options.history = value;
+    } else if ((value = Value(arg, "--history-size"))) {
+      std::size_t megabytes = 0;
+      ok = ParseCount(value, megabytes) && megabytes > 0;
+      options.historySize = megabytes << 20;
+    } else if ((value = Value(arg, "--replay"))) {
+      options.mode = Options::Mode::kReplay;
+      options.replay = value;
+    } else if ((value = Value(arg, "--proc-root"))) {
+      options.procRoot = value;
+    } else if ((value = Value(arg, "--etc-root"))) {
+      options.etcRoot = value;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "monitor: bad option '%s'\n%s", arg, kUsage);
+      return false;
+    }
+  }
+  return true;
+}
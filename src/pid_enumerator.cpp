@@ -0,0 +1,75 @@
+#include "pid_enumerator.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "instrument.h"
+
+namespace {
+// Record layout returned by getdents64(2)
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+constexpr std::size_t kBufferSize = 64 * 1024;
+
+// Return the PID named by name, or -1 if it isn't all digits
+int ParsePid(const char* name) {
+  if (*name == '\0') return -1;
+  int pid = 0;
+  for (; *name != '\0'; ++name) {
+    if (*name < '0' || *name > '9') return -1;
+    pid = pid * 10 + (*name - '0');
+  }
+  return pid;
+}
+}  // namespace
+
+PidEnumerator::PidEnumerator(std::string directory)
+    : directory_(std::move(directory)), buffer_(kBufferSize) {}
+
+PidEnumerator::~PidEnumerator() {
+  if (fd_ >= 0) close(fd_);
+}
+
+bool PidEnumerator::Read(std::vector<int>& pids, bool sorted) {
+  pids.clear();
+  INSTRUMENT_COUNT(kSyscalls, 1);  // open or lseek
+  if (fd_ < 0) {
+    fd_ = open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd_ < 0) return false;
+  } else if (lseek(fd_, 0, SEEK_SET) != 0) {
+    return false;
+  }
+
+  while (true) {
+    long n = syscall(SYS_getdents64, fd_, buffer_.data(), buffer_.size());
+    INSTRUMENT_COUNT(kSyscalls, 1);
+    if (n < 0) return false;
+    INSTRUMENT_COUNT(kBytesRead, n);
+    if (n == 0) break;
+    for (long offset = 0; offset < n;) {
+      auto entry = reinterpret_cast<const LinuxDirent64*>(&buffer_[offset]);
+      offset += entry->d_reclen;
+      if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+      int pid = ParsePid(entry->d_name);
+      if (pid > 0) pids.push_back(pid);
+    }
+  }
+
+  // /proc already lists processes in ascending order, so this rarely sorts
+  if (sorted && !std::is_sorted(pids.begin(), pids.end())) {
+    std::sort(pids.begin(), pids.end());
+  }
+  return true;
+}
@@ -0,0 +1,70 @@
+#include "pressure_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "proc_file_cache.h"
+
+namespace {
+const ProcFileCache::Global kFiles[] = {
+    ProcFileCache::Global::kPressureCpu,
+    ProcFileCache::Global::kPressureMemory,
+    ProcFileCache::Global::kPressureIo,
+};
+
+// Parse "some avg10=2.05 avg60=12.14 avg300=21.84 total=403348476" into
+// stall, which holds the previous read unless elapsed is 0
+bool ParseLine(const char* line, PressureStats::Stall& stall,
+               double elapsed) {
+  float avg10, avg60;
+  unsigned long long total;
+  if (std::sscanf(line, "%*s avg10=%f avg60=%f avg300=%*f total=%llu",
+                  &avg10, &avg60, &total) != 3)
+    return false;
+  // Averages are percentages
+  stall.avg10 = avg10 / 100;
+  stall.avg60 = avg60 / 100;
+  stall.interval =
+      elapsed > 0 && total >= stall.totalUs
+          ? std::min(1.0f, static_cast<float>((total - stall.totalUs) /
+                                              (elapsed * 1e6)))
+          : 0.0f;
+  stall.totalUs = total;
+  return true;
+}
+}  // namespace
+
+const char* PressureStats::Name(Resource resource) {
+  static const char* const names[] = {"cpu", "memory", "io"};
+  return names[resource];
+}
+
+void PressureStats::Read(double elapsed) {
+  for (int resource = 0; resource < kResources; ++resource) {
+    Pressure& pressure = pressures_[resource];
+    if (missing_[resource]) continue;
+    if (!ProcFileCache::Instance().Read(kFiles[resource], buffer_)) {
+      missing_[resource] = true;
+      pressure = {};
+      continue;
+    }
+    double interval = pressure.available ? elapsed : 0;
+    // Kernels before 5.13 have no "full" line for the CPU
+    bool some = false;
+    for (const char* p = buffer_.c_str(); *p != '\0';) {
+      if (std::strncmp(p, "some ", 5) == 0) {
+        some = ParseLine(p, pressure.some, interval);
+      } else if (std::strncmp(p, "full ", 5) == 0) {
+        ParseLine(p, pressure.full, interval);
+      }
+      const char* eol = std::strchr(p, '\n');
+      p = eol == nullptr ? p + std::strlen(p) : eol + 1;
+    }
+    pressure.available = some;
+  }
+}
+
+const PressureStats::Pressures& PressureStats::Values() const {
+  return pressures_;
+}
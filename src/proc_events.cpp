@@ -0,0 +1,195 @@
+#include "proc_events.h"
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "proc_parser.h"
+
+namespace {
+// How often the listener checks whether it should stop
+constexpr int kPollMilliseconds = 250;
+
+// How long Start() waits for the first event
+constexpr std::chrono::milliseconds kProbeTimeout{500};
+
+// Queue bound; beyond this the consumer has fallen behind and rescans
+constexpr std::size_t kMaxPending = 1 << 16;
+}  // namespace
+
+ProcEvents::~ProcEvents() { Stop(); }
+
+bool ProcEvents::Start() {
+  if (active_) return true;
+  socket_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (socket_ < 0) return false;
+  sockaddr_nl address{};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  address.nl_pid = 0;
+  int size = 4 * 1024 * 1024;
+  setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      !Subscribe(true)) {
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+  stop_ = false;
+  active_ = true;
+  thread_ = std::thread(&ProcEvents::Run, this);
+
+  // Outside the initial network namespace the subscription succeeds but no
+  // events are ever delivered. Creating a thread raises a fork event, so
+  // wait for that to confirm events really arrive.
+  std::thread([] {}).join();
+  auto deadline = std::chrono::steady_clock::now() + kProbeTimeout;
+  while (!delivered_ && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  if (!delivered_) {
+    Stop();
+    return false;
+  }
+  return true;
+}
+
+void ProcEvents::Stop() {
+  stop_ = true;
+  if (thread_.joinable()) thread_.join();
+  if (socket_ >= 0) {
+    Subscribe(false);
+    close(socket_);
+    socket_ = -1;
+  }
+  active_ = false;
+}
+
+// True while events are being received
+bool ProcEvents::Active() const { return active_; }
+
+void ProcEvents::Drain(Batch& batch) {
+  batch.started.clear();
+  batch.execed.clear();
+  batch.exited.clear();
+  batch.lost = false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::swap(batch, pending_);
+  // Without a listener nothing is known about the interval
+  batch.lost = batch.lost || !active_;
+  pending_.lost = false;
+}
+
+// Ask the kernel to start or stop multicasting process events to us
+bool ProcEvents::Subscribe(bool listen) {
+  alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) +
+                                            sizeof(proc_cn_mcast_op))] = {};
+  auto header = reinterpret_cast<nlmsghdr*>(buffer);
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+  header->nlmsg_type = NLMSG_DONE;
+  header->nlmsg_pid = 0;
+  auto message = static_cast<cn_msg*>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(proc_cn_mcast_op);
+  proc_cn_mcast_op op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+  std::memcpy(message->data, &op, sizeof(op));
+  return send(socket_, header, header->nlmsg_len, 0) >= 0;
+}
+
+void ProcEvents::Run() {
+  alignas(nlmsghdr) char buffer[16 * 1024];
+  pollfd descriptor{socket_, POLLIN, 0};
+  while (!stop_) {
+    int ready = poll(&descriptor, 1, kPollMilliseconds);
+    if (ready < 0 && errno != EINTR) break;
+    if (ready <= 0) continue;
+    ssize_t n = recv(socket_, buffer, sizeof(buffer), 0);
+    if (n < 0) {
+      if (errno == ENOBUFS) {
+        // The socket overflowed; the consumer must rescan /proc
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.lost = true;
+        continue;
+      }
+      if (errno == EINTR || errno == EAGAIN) continue;
+      break;
+    }
+    auto length = static_cast<unsigned int>(n);
+    for (auto header = reinterpret_cast<nlmsghdr*>(buffer);
+         NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_type == NLMSG_ERROR ||
+          header->nlmsg_type == NLMSG_NOOP)
+        continue;
+      auto message = static_cast<const cn_msg*>(NLMSG_DATA(header));
+      if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+        continue;
+      delivered_ = true;
+      Handle(message->data);
+    }
+  }
+  active_ = false;
+}
+
+// Queue one event; only whole processes (thread group leaders) matter
+void ProcEvents::Handle(const void* data) {
+  proc_event event;
+  std::memcpy(&event, data, sizeof(event));
+  switch (event.what) {
+    case proc_event::PROC_EVENT_FORK:
+      if (event.event_data.fork.child_pid !=
+          event.event_data.fork.child_tgid)
+        return;
+      break;
+    case proc_event::PROC_EVENT_EXEC:
+      break;
+    case proc_event::PROC_EVENT_EXIT:
+      if (event.event_data.exit.process_pid !=
+          event.event_data.exit.process_tgid)
+        return;
+      break;
+    default:
+      return;
+  }
+
+  Exit exit{0, 0, 0};
+  if (event.what == proc_event::PROC_EVENT_EXIT) {
+    // Until the parent reaps it the process can still be read, which
+    // captures the CPU time of processes that never lived through a tick.
+    // The file isn't kept open: most exiting pids were never tracked, and
+    // their descriptors would push live ones out of the cache.
+    exit.pid = event.event_data.exit.process_pid;
+    ProcParser::Stat stat;
+    if (ProcParser::ReadStatOnce(exit.pid, stat)) {
+      exit.startTime = stat.startTime;
+      exit.activeJiffies = stat.utime + stat.stime;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_.started.size() + pending_.execed.size() +
+          pending_.exited.size() >=
+      kMaxPending) {
+    pending_.lost = true;
+    return;
+  }
+  switch (event.what) {
+    case proc_event::PROC_EVENT_FORK:
+      pending_.started.push_back(event.event_data.fork.child_tgid);
+      break;
+    case proc_event::PROC_EVENT_EXEC:
+      pending_.execed.push_back(event.event_data.exec.process_tgid);
+      break;
+    default:
+      pending_.exited.push_back(exit);
+      break;
+  }
+}
@@ -0,0 +1,276 @@
+#include "proc_file_cache.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#include "instrument.h"
+#include "linux_parser.h"
+
+namespace {
+// Descriptors left for everything else the monitor opens
+constexpr std::size_t kReservedFds = 64;
+
+const char* const kPidFileNames[] = {"stat", "statm", "io"};
+
+std::string GlobalPath(ProcFileCache::Global file) {
+  static const std::string* const names[] = {
+      &LinuxParser::kStatFilename,
+      &LinuxParser::kMeminfoFilename,
+      &LinuxParser::kUptimeFilename,
+      &LinuxParser::kLoadavgFilename,
+      &LinuxParser::kDiskstatsFilename,
+      &LinuxParser::kNetDevFilename,
+      &LinuxParser::kPressureCpuFilename,
+      &LinuxParser::kPressureMemoryFilename,
+      &LinuxParser::kPressureIoFilename,
+  };
+  return LinuxParser::ProcDirectory() + *names[static_cast<std::size_t>(file)];
+}
+
+// Allow the cache half of what the soft descriptor limit leaves
+std::size_t DefaultBudget() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+  if (limit.rlim_cur == RLIM_INFINITY) return 1 << 20;
+  auto soft = static_cast<std::size_t>(limit.rlim_cur);
+  return soft > kReservedFds ? (soft - kReservedFds) / 2 : 0;
+}
+
+// Below one page a proc file arrives in a single read, so a short read at
+// that size is the end of the file
+constexpr std::size_t kSingleReadSize = 4096;
+}  // namespace
+
+ProcFileCache::ProcFileCache(std::size_t budget)
+    : budget_(budget == 0 ? DefaultBudget() : budget) {
+  globals_.fill(-1);
+}
+
+ProcFileCache::~ProcFileCache() {
+  for (auto& shard : shards_) {
+    while (!shard.lru.empty()) Close(shard, shard.lru.back());
+  }
+  for (int fd : globals_) CloseFd(fd);
+}
+
+ProcFileCache& ProcFileCache::Instance() {
+  static ProcFileCache cache;
+  return cache;
+}
+
+// A budget far below the process count would only make the LRU thrash, so
+// the monitor asks for all the descriptors it may have
+bool ProcFileCache::RaiseDescriptorLimit() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return false;
+  if (limit.rlim_cur == limit.rlim_max) return true;
+  limit.rlim_cur = limit.rlim_max;
+  return setrlimit(RLIMIT_NOFILE, &limit) == 0;
+}
+
+std::size_t ProcFileCache::Budget() const { return budget_; }
+
+ProcFileCache::Counters ProcFileCache::Count() const {
+  return {opens_.load(), reads_.load(), closes_.load()};
+}
+
+ssize_t ProcFileCache::Read(Global file, char* buffer, std::size_t size) {
+  if (budget_ < kShards) {
+    return ReadPath(GlobalPath(file).c_str(), buffer, size);
+  }
+  std::lock_guard<std::mutex> lock(globalMutex_);
+  int& fd = globals_[static_cast<std::size_t>(file)];
+  if (fd < 0) fd = Open(GlobalPath(file).c_str());
+  if (fd < 0) return -1;
+  return ReadFd(fd, buffer, size);
+}
+
+// Read a global file of any length, growing buffer as needed
+bool ProcFileCache::Read(Global file, std::string& buffer) {
+  // Use all the capacity grown by earlier reads
+  buffer.resize(std::max<std::size_t>(buffer.capacity(), 4096));
+  while (true) {
+    ssize_t n = Read(file, &buffer[0], buffer.size());
+    if (n < 0) return false;
+    if (static_cast<std::size_t>(n) < buffer.size() - 1) {
+      buffer.resize(static_cast<std::size_t>(n));
+      return true;
+    }
+    buffer.resize(buffer.size() * 2);
+  }
+}
+
+ssize_t ProcFileCache::Read(int pid, PidFile file, char* buffer,
+                            std::size_t size) {
+  auto index = static_cast<std::size_t>(file);
+  if (budget_ < kShards) {
+    char path[256];
+    std::snprintf(path, sizeof(path), "%s%d/%s",
+                  LinuxParser::ProcDirectory().c_str(), pid,
+                  kPidFileNames[index]);
+    return ReadPath(path, buffer, size);
+  }
+  Shard& shard = ShardOf(pid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // A second attempt reopens everything if the cached descriptors belong
+  // to a process that has gone
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    Entry* entry = Lookup(shard, pid);
+    if (entry == nullptr) return -1;
+    int& fd = entry->files[index];
+    if (fd < 0) {
+      fd = OpenAt(entry->dir, kPidFileNames[index]);
+      if (fd >= 0) ++shard.fds;
+    }
+    ssize_t n = fd >= 0 ? ReadFd(fd, buffer, size) : -1;
+    if (n >= 0) {
+      Trim(shard, pid);
+      return n;
+    }
+    int error = errno;
+    Close(shard, pid);
+    errno = error;
+    if (error != ESRCH && error != ENOENT) break;
+  }
+  return -1;
+}
+
+ssize_t ProcFileCache::ReadOnce(int pid, const char* name, char* buffer,
+                                std::size_t size) {
+  if (budget_ >= kShards) {
+    Shard& shard = ShardOf(pid);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(pid);
+    if (it != shard.entries.end()) {
+      int fd = OpenAt(it->second.dir, name);
+      if (fd < 0) return -1;
+      ssize_t n = ReadFd(fd, buffer, size);
+      CloseFd(fd);
+      return n;
+    }
+  }
+  char path[256];
+  std::snprintf(path, sizeof(path), "%s%d/%s",
+                LinuxParser::ProcDirectory().c_str(), pid, name);
+  return ReadPath(path, buffer, size);
+}
+
+void ProcFileCache::Evict(int pid) {
+  if (budget_ < kShards) return;
+  Shard& shard = ShardOf(pid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Close(shard, pid);
+}
+
+ProcFileCache::Shard& ProcFileCache::ShardOf(int pid) {
+  return shards_[static_cast<std::size_t>(pid) % kShards];
+}
+
+// Find or create the entry of pid and mark it as most recently used
+ProcFileCache::Entry* ProcFileCache::Lookup(Shard& shard, int pid) {
+  auto it = shard.entries.find(pid);
+  if (it != shard.entries.end()) {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+    return &it->second;
+  }
+  char path[256];
+  std::snprintf(path, sizeof(path), "%s%d",
+                LinuxParser::ProcDirectory().c_str(), pid);
+  int dir = Open(path, O_DIRECTORY);
+  if (dir < 0) return nullptr;
+  Entry& entry = shard.entries[pid];
+  entry.dir = dir;
+  entry.files.fill(-1);
+  shard.lru.push_front(pid);
+  entry.lru = shard.lru.begin();
+  ++shard.fds;
+  return &entry;
+}
+
+// Close every descriptor of pid and forget it
+void ProcFileCache::Close(Shard& shard, int pid) {
+  auto it = shard.entries.find(pid);
+  if (it == shard.entries.end()) return;
+  Entry& entry = it->second;
+  CloseFd(entry.dir);
+  --shard.fds;
+  for (int fd : entry.files) {
+    if (fd >= 0) {
+      CloseFd(fd);
+      --shard.fds;
+    }
+  }
+  shard.lru.erase(entry.lru);
+  shard.entries.erase(it);
+}
+
+// Close least recently used processes until the shard is within its share
+// of the budget, never closing keep
+void ProcFileCache::Trim(Shard& shard, int keep) {
+  const std::size_t limit = budget_ / kShards;
+  while (shard.fds > limit && shard.lru.back() != keep) {
+    Close(shard, shard.lru.back());
+  }
+}
+
+int ProcFileCache::OpenFile(const char* path) { return Open(path); }
+
+ssize_t ProcFileCache::ReadFile(int fd, char* buffer, std::size_t size) {
+  return ReadFd(fd, buffer, size);
+}
+
+void ProcFileCache::CloseFile(int fd) { CloseFd(fd); }
+
+int ProcFileCache::Open(const char* path, int flags) {
+  ++opens_;
+  INSTRUMENT_COUNT(kSyscalls, 1);
+  return open(path, O_RDONLY | O_CLOEXEC | flags);
+}
+
+int ProcFileCache::OpenAt(int dir, const char* name) {
+  ++opens_;
+  INSTRUMENT_COUNT(kSyscalls, 1);
+  return openat(dir, name, O_RDONLY | O_CLOEXEC);
+}
+
+void ProcFileCache::CloseFd(int fd) {
+  if (fd < 0) return;
+  ++closes_;
+  INSTRUMENT_COUNT(kSyscalls, 1);
+  close(fd);
+}
+
+// pread the whole file from offset 0 and NUL-terminate it
+ssize_t ProcFileCache::ReadFd(int fd, char* buffer, std::size_t size) {
+  std::size_t length = 0;
+  while (length < size - 1) {
+    ++reads_;
+    INSTRUMENT_COUNT(kSyscalls, 1);
+    std::size_t wanted = size - 1 - length;
+    ssize_t n = pread(fd, buffer + length, wanted, static_cast<off_t>(length));
+    if (n < 0) return -1;
+    length += static_cast<std::size_t>(n);
+    if (n == 0 || (static_cast<std::size_t>(n) < wanted &&
+                   length < kSingleReadSize))
+      break;
+  }
+  buffer[length] = '\0';
+  INSTRUMENT_COUNT(kBytesRead, length);
+  return static_cast<ssize_t>(length);
+}
+
+ssize_t ProcFileCache::ReadPath(const char* path, char* buffer,
+                                std::size_t size) {
+  int fd = Open(path);
+  if (fd < 0) return -1;
+  ssize_t n = ReadFd(fd, buffer, size);
+  int error = errno;
+  CloseFd(fd);
+  errno = error;
+  return n;
+}
@@ -0,0 +1,223 @@
+#include "proc_parser.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "proc_file_cache.h"
+
+namespace {
+// Large enough for /proc/[pid]/stat (~350 bytes), status (~1.5 KB) and
+// smaps_rollup (~1 KB)
+constexpr std::size_t kBufferSize = 4096;
+
+// Parse a (possibly negative) decimal integer, advancing p past it and any
+// leading blanks
+int64_t ParseInt(const char*& p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t')) ++p;
+  bool negative = p < end && *p == '-';
+  if (negative) ++p;
+  int64_t value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+  return negative ? -value : value;
+}
+
+// Return true and advance p past key if the line at p starts with it
+bool Consume(const char*& p, const char* end, const char* key,
+             std::size_t length) {
+  if (static_cast<std::size_t>(end - p) < length ||
+      std::memcmp(p, key, length) != 0)
+    return false;
+  p += length;
+  return true;
+}
+}  // namespace
+
+// Parse the contents of /proc/[pid]/stat.
+// comm is delimited by the first '(' and the *last* ')' since the name itself
+// may contain spaces and parentheses.
+bool ProcParser::ParseStat(const char* buffer, std::size_t size, Stat& stat) {
+  const char* end = buffer + size;
+  auto open = static_cast<const char*>(std::memchr(buffer, '(', size));
+  if (open == nullptr) return false;
+  const char* close = nullptr;
+  for (const char* p = end; p > open;) {
+    if (*--p == ')') {
+      close = p;
+      break;
+    }
+  }
+  if (close == nullptr || close + 2 >= end) return false;
+
+  std::size_t length = static_cast<std::size_t>(close - open - 1);
+  if (length >= kCommLength) length = kCommLength - 1;
+  std::memcpy(stat.comm, open + 1, length);
+  stat.comm[length] = '\0';
+
+  const char* p = close + 2;
+  stat.state = *p++;
+
+  // Fields 4 (ppid) through 24 (rss), in order
+  int64_t fields[21];
+  for (auto& field : fields) {
+    if (p >= end) return false;
+    field = ParseInt(p, end);
+  }
+  stat.ppid = static_cast<int>(fields[0]);
+  stat.utime = static_cast<uint64_t>(fields[10]);
+  stat.stime = static_cast<uint64_t>(fields[11]);
+  stat.cutime = fields[12];
+  stat.cstime = fields[13];
+  stat.numThreads = fields[16];
+  stat.startTime = static_cast<uint64_t>(fields[18]);
+  stat.vsize = static_cast<uint64_t>(fields[19]);
+  stat.rss = fields[20];
+  return true;
+}
+
+// Parse the contents of /proc/[pid]/status
+bool ProcParser::ParseStatus(const char* buffer, std::size_t size,
+                             Status& status) {
+  const char* p = buffer;
+  const char* end = buffer + size;
+  while (p < end) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (eol == nullptr) eol = end;
+    if (*p == 'U' && Consume(p, eol, "Uid:", 4)) {
+      status.uid = static_cast<int>(ParseInt(p, eol));
+    } else if (*p == 'V') {
+      if (Consume(p, eol, "VmSize:", 7)) {
+        status.vmSizeKb = static_cast<uint64_t>(ParseInt(p, eol));
+      } else if (Consume(p, eol, "VmRSS:", 6)) {
+        status.vmRssKb = static_cast<uint64_t>(ParseInt(p, eol));
+      }
+    }
+    p = eol + 1;
+  }
+  return status.uid >= 0;
+}
+
+// Parse the contents of /proc/[pid]/statm: size resident shared text lib
+// data dirty
+bool ProcParser::ParseStatm(const char* buffer, std::size_t size,
+                            Statm& statm) {
+  const char* p = buffer;
+  const char* end = buffer + size;
+  if (p >= end || *p < '0' || *p > '9') return false;
+  statm.size = static_cast<uint64_t>(ParseInt(p, end));
+  statm.resident = static_cast<uint64_t>(ParseInt(p, end));
+  statm.shared = static_cast<uint64_t>(ParseInt(p, end));
+  return true;
+}
+
+// Parse the contents of /proc/[pid]/smaps_rollup; the first line is the
+// address range of the rollup and is skipped
+bool ProcParser::ParseSmapsRollup(const char* buffer, std::size_t size,
+                                  SmapsRollup& rollup) {
+  const char* p = buffer;
+  const char* end = buffer + size;
+  bool found = false;
+  while (p < end) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (eol == nullptr) eol = end;
+    if (Consume(p, eol, "Rss:", 4)) {
+      rollup.rssKb = static_cast<uint64_t>(ParseInt(p, eol));
+    } else if (Consume(p, eol, "Pss:", 4)) {
+      rollup.pssKb = static_cast<uint64_t>(ParseInt(p, eol));
+      found = true;
+    } else if (Consume(p, eol, "Swap:", 5)) {
+      rollup.swapKb = static_cast<uint64_t>(ParseInt(p, eol));
+    }
+    p = eol + 1;
+  }
+  return found;
+}
+
+// Parse the contents of /proc/[pid]/io
+bool ProcParser::ParseIo(const char* buffer, std::size_t size, Io& io) {
+  const char* p = buffer;
+  const char* end = buffer + size;
+  bool found = false;
+  while (p < end) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (eol == nullptr) eol = end;
+    if (Consume(p, eol, "read_bytes:", 11)) {
+      io.readBytes = static_cast<uint64_t>(ParseInt(p, eol));
+      found = true;
+    } else if (Consume(p, eol, "write_bytes:", 12)) {
+      io.writeBytes = static_cast<uint64_t>(ParseInt(p, eol));
+    } else if (Consume(p, eol, "cancelled_write_bytes:", 22)) {
+      io.cancelledWriteBytes = static_cast<uint64_t>(ParseInt(p, eol));
+    }
+    p = eol + 1;
+  }
+  return found;
+}
+
+// Read and parse /proc/[pid]/stat, which is kept open across ticks
+bool ProcParser::ReadStat(int pid, Stat& stat) {
+  char buffer[kBufferSize];
+  ssize_t n = ProcFileCache::Instance().Read(
+      pid, ProcFileCache::PidFile::kStat, buffer, sizeof(buffer));
+  return n > 0 && ParseStat(buffer, static_cast<std::size_t>(n), stat);
+}
+
+// Read and parse /proc/[pid]/stat of a process that isn't tracked
+bool ProcParser::ReadStatOnce(int pid, Stat& stat) {
+  char buffer[kBufferSize];
+  ssize_t n =
+      ProcFileCache::Instance().ReadOnce(pid, "stat", buffer, sizeof(buffer));
+  return n > 0 && ParseStat(buffer, static_cast<std::size_t>(n), stat);
+}
+
+// Read and parse /proc/[pid]/status
+bool ProcParser::ReadStatus(int pid, Status& status) {
+  char buffer[kBufferSize];
+  ssize_t n =
+      ProcFileCache::Instance().ReadOnce(pid, "status", buffer, sizeof(buffer));
+  return n > 0 && ParseStatus(buffer, static_cast<std::size_t>(n), status);
+}
+
+// Read and parse /proc/[pid]/statm, which is kept open across ticks
+bool ProcParser::ReadStatm(int pid, Statm& statm) {
+  char buffer[kBufferSize];
+  ssize_t n = ProcFileCache::Instance().Read(
+      pid, ProcFileCache::PidFile::kStatm, buffer, sizeof(buffer));
+  return n > 0 && ParseStatm(buffer, static_cast<std::size_t>(n), statm);
+}
+
+// Read and parse /proc/[pid]/smaps_rollup (Linux 4.14 and later)
+bool ProcParser::ReadSmapsRollup(int pid, SmapsRollup& rollup) {
+  char buffer[kBufferSize];
+  ssize_t n = ProcFileCache::Instance().ReadOnce(pid, "smaps_rollup", buffer,
+                                                 sizeof(buffer));
+  return n > 0 &&
+         ParseSmapsRollup(buffer, static_cast<std::size_t>(n), rollup);
+}
+
+// Read and parse /proc/[pid]/task/[tid]/stat
+bool ProcParser::ReadTaskStat(int pid, int tid, Stat& stat) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "task/%d/stat", tid);
+  char buffer[kBufferSize];
+  ssize_t n =
+      ProcFileCache::Instance().ReadOnce(pid, name, buffer, sizeof(buffer));
+  return n > 0 && ParseStat(buffer, static_cast<std::size_t>(n), stat);
+}
+
+// Read and parse /proc/[pid]/io, which is kept open across ticks
+bool ProcParser::ReadIo(int pid, Io& io, int* error) {
+  char buffer[kBufferSize];
+  ssize_t n = ProcFileCache::Instance().Read(
+      pid, ProcFileCache::PidFile::kIo, buffer, sizeof(buffer));
+  if (n < 0) {
+    if (error != nullptr) *error = errno;
+    return false;
+  }
+  if (n > 0 && ParseIo(buffer, static_cast<std::size_t>(n), io)) return true;
+  if (error != nullptr) *error = EINVAL;
+  return false;
+}
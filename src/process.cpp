@@ -1,33 +1,63 @@
 #include "process.h"
 
-#include "linux_parser.h"
+#include "process_table.h"
 
-using std::string;
-
-Process::Process(int pid)
-    : cpuUtilization_(LinuxParser::CpuUtilization(pid)), pid_(pid) {}
+Process::Process(const ProcessTable& table, std::size_t row)
+    : table_(&table), row_(row) {}
 
 // Return this process's ID
-int Process::Pid() const { return pid_; }
+int Process::Pid() const { return table_->pid_[row_]; }
+
+// Return the ID of this process's parent
+int Process::ParentPid() const { return table_->ppid_[row_]; }
+
+// Return the real user ID of this process
+int Process::Uid() const { return table_->uid_[row_]; }
+
+// Return the start time (clock ticks after boot) identifying this process
+uint64_t Process::StartTime() const { return table_->startTime_[row_]; }
 
 // Return this process's CPU utilization
-float Process::CpuUtilization() const {
-  return cpuUtilization_;
-}
+float Process::CpuUtilization() const { return table_->cpu_[row_]; }
 
 // Return the command that generated this process
-string Process::Command() const { return LinuxParser::Command(pid_); }
+const char* Process::Command() const {
+  return table_->strings_.Get(table_->command_[row_]);
+}
 
-// Return this process's memory utilization
-string Process::Ram() const { return LinuxParser::Ram(pid_); }
+// Return this process's memory use
+Process::Memory Process::Ram() const {
+  Memory ram;
+  ram.rssKb = table_->rssKb_[row_];
+  ram.sharedKb = table_->sharedKb_[row_];
+  ram.pssKb = table_->pssKb_[row_];
+  ram.swapKb = table_->swapKb_[row_];
+  ram.accurate = table_->flags_[row_] & ProcessTable::kAccurate;
+  return ram;
+}
+
+// Return the number of threads seen by the last sample
+int64_t Process::ThreadCount() const { return table_->threads_[row_]; }
+
+// Return the storage I/O rates of the last tick
+Process::Io Process::DiskIo() const {
+  Io io;
+  io.readRate = table_->readRate_[row_];
+  io.writeRate = table_->writeRate_[row_];
+  io.known = table_->flags_[row_] & ProcessTable::kIoKnown;
+  return io;
+}
 
 // Return the user (name) that generated this process
-string Process::User() const { return LinuxParser::User(pid_); }
+const char* Process::User() const {
+  return table_->strings_.Get(table_->user_[row_]);
+}
 
 // Return the age of this process (in seconds)
-long int Process::UpTime() const { return LinuxParser::UpTime(pid_); }
+long int Process::UpTime() const { return table_->upTime_[row_]; }
+
+// Return the tick in which this process was last observed
+uint64_t Process::LastSeen() const { return table_->lastSeen_[row_]; }
 
-// Overload the "less than" comparison operator for Process objects
-bool Process::operator<(Process const& a) const {
-  return cpuUtilization_ < a.cpuUtilization_;
-}
\ No newline at end of file
+// Return the user + system jiffies recorded by the last sample
+uint64_t Process::ActiveJiffies() const { return table_->jiffies_[row_]; }
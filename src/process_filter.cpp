@@ -0,0 +1,69 @@
+#include "process_filter.h"
+
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+namespace {
+constexpr char kUserPrefix[] = "user:";
+constexpr char kRegexPrefix[] = "re:";
+
+bool StartsWith(const std::string& text, const char* prefix) {
+  return text.compare(0, std::strlen(prefix), prefix) == 0;
+}
+}  // namespace
+
+bool ProcessFilter::Compile(const std::string& text, std::string* error) {
+  std::vector<std::string> users, substrings;
+  std::vector<std::shared_ptr<const regex_t>> patterns;
+  std::istringstream terms(text);
+  std::string term;
+  while (terms >> term) {
+    if (StartsWith(term, kUserPrefix)) {
+      users.push_back(term.substr(std::strlen(kUserPrefix)));
+    } else if (StartsWith(term, kRegexPrefix)) {
+      auto regex = std::make_unique<regex_t>();
+      int status =
+          regcomp(regex.get(), term.c_str() + std::strlen(kRegexPrefix),
+                  REG_EXTENDED | REG_NOSUB);
+      if (status != 0) {
+        if (error != nullptr) {
+          char message[128];
+          regerror(status, regex.get(), message, sizeof(message));
+          *error = message;
+        }
+        return false;
+      }
+      patterns.emplace_back(regex.release(), [](regex_t* compiled) {
+        regfree(compiled);
+        delete compiled;
+      });
+    } else {
+      substrings.push_back(std::move(term));
+    }
+  }
+  text_ = text;
+  users_ = std::move(users);
+  substrings_ = std::move(substrings);
+  patterns_ = std::move(patterns);
+  return true;
+}
+
+bool ProcessFilter::Empty() const {
+  return users_.empty() && substrings_.empty() && patterns_.empty();
+}
+
+const std::string& ProcessFilter::Text() const { return text_; }
+
+bool ProcessFilter::Matches(const char* user, const char* command) const {
+  for (const auto& name : users_) {
+    if (name != user) return false;
+  }
+  for (const auto& substring : substrings_) {
+    if (strcasestr(command, substring.c_str()) == nullptr) return false;
+  }
+  for (const auto& pattern : patterns_) {
+    if (regexec(pattern.get(), command, 0, nullptr, 0) != 0) return false;
+  }
+  return true;
+}
@@ -0,0 +1,345 @@
+#include "process_table.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+
+#include "linux_parser.h"
+
+namespace {
+constexpr std::size_t kInitialSlots = 64;
+
+// Ticks between smaps_rollup reads of a displayed process
+constexpr uint64_t kRollupInterval = 5;
+
+// FNV-1a of comm, enough to notice that it changed
+uint32_t Hash(const char* text) {
+  uint32_t hash = 2166136261u;
+  for (; *text != '\0'; ++text) {
+    hash = (hash ^ static_cast<unsigned char>(*text)) * 16777619u;
+  }
+  return hash;
+}
+
+// Consecutive pids spread over the index
+std::size_t Mix(int pid) {
+  uint32_t hash = static_cast<uint32_t>(pid) * 2654435761u;
+  return hash ^ (hash >> 16);
+}
+}  // namespace
+
+template <typename Fn>
+void ProcessTable::Columns(Fn fn) {
+  fn(&ProcessTable::pid_);
+  fn(&ProcessTable::ppid_);
+  fn(&ProcessTable::uid_);
+  fn(&ProcessTable::state_);
+  fn(&ProcessTable::flags_);
+  fn(&ProcessTable::threads_);
+  fn(&ProcessTable::startTime_);
+  fn(&ProcessTable::jiffies_);
+  fn(&ProcessTable::lastSeen_);
+  fn(&ProcessTable::commHash_);
+  fn(&ProcessTable::cpu_);
+  fn(&ProcessTable::rssKb_);
+  fn(&ProcessTable::sharedKb_);
+  fn(&ProcessTable::pssKb_);
+  fn(&ProcessTable::swapKb_);
+  fn(&ProcessTable::rollupTick_);
+  fn(&ProcessTable::readRate_);
+  fn(&ProcessTable::writeRate_);
+  fn(&ProcessTable::ioTick_);
+  fn(&ProcessTable::ioUptime_);
+  fn(&ProcessTable::ioRead_);
+  fn(&ProcessTable::ioWritten_);
+  fn(&ProcessTable::upTime_);
+  fn(&ProcessTable::command_);
+  fn(&ProcessTable::user_);
+  fn(&ProcessTable::match_);
+  fn(&ProcessTable::rank_);
+}
+
+ProcessTable::ProcessTable() : slots_(kInitialSlots) {}
+
+std::size_t ProcessTable::size() const { return pid_.size(); }
+
+bool ProcessTable::empty() const { return pid_.empty(); }
+
+Process ProcessTable::operator[](std::size_t row) const {
+  return Process(*this, row);
+}
+
+ProcessTable::Iterator ProcessTable::begin() const {
+  return Iterator(*this, 0);
+}
+
+ProcessTable::Iterator ProcessTable::end() const {
+  return Iterator(*this, size());
+}
+
+// Slot holding pid, or the empty slot where it would go
+std::size_t ProcessTable::Slot(int pid) const {
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = Mix(pid) & mask;; i = (i + 1) & mask) {
+    if (slots_[i] == 0 || pid_[slots_[i] - 1] == pid) return i;
+  }
+}
+
+std::size_t ProcessTable::Find(int pid) const {
+  uint32_t entry = slots_[Slot(pid)];
+  return entry == 0 ? npos : entry - 1;
+}
+
+std::size_t ProcessTable::Add(int pid, uint64_t startTime) {
+  std::size_t row = size();
+  if ((row + 1) * 2 > slots_.size()) Rehash(slots_.size() * 2);
+  Columns([this](auto column) { (this->*column).emplace_back(); });
+  pid_[row] = pid;
+  uid_[row] = -1;
+  state_[row] = '?';
+  startTime_[row] = startTime;
+  rank_[row] = kUnranked;
+  slots_[Slot(pid)] = static_cast<uint32_t>(row + 1);
+  return row;
+}
+
+void ProcessTable::Reset(std::size_t row, uint64_t startTime) {
+  int pid = pid_[row];
+  strings_.Release(command_[row]);
+  strings_.Release(user_[row]);
+  Columns([this, row](auto column) { (this->*column)[row] = {}; });
+  pid_[row] = pid;
+  uid_[row] = -1;
+  state_[row] = '?';
+  startTime_[row] = startTime;
+  // The old process's slot in the ranking is left empty
+  rank_[row] = kUnranked;
+}
+
+void ProcessTable::Remove(std::size_t row) {
+  strings_.Release(command_[row]);
+  strings_.Release(user_[row]);
+  Unindex(pid_[row]);
+  std::size_t last = size() - 1;
+  if (row != last) {
+    slots_[Slot(pid_[last])] = static_cast<uint32_t>(row + 1);
+    Columns([this, row, last](auto column) {
+      (this->*column)[row] = (this->*column)[last];
+    });
+  }
+  Columns([this](auto column) { (this->*column).pop_back(); });
+}
+
+// Remove pid from the index, shifting back the entries probed past it so
+// lookups never stop short at the hole
+void ProcessTable::Unindex(int pid) {
+  std::size_t mask = slots_.size() - 1;
+  std::size_t i = Slot(pid);
+  slots_[i] = 0;
+  for (std::size_t j = (i + 1) & mask; slots_[j] != 0; j = (j + 1) & mask) {
+    std::size_t home = Mix(pid_[slots_[j] - 1]) & mask;
+    // An entry stays if its home slot lies cyclically in (i, j]
+    bool stays = i <= j ? i < home && home <= j : i < home || home <= j;
+    if (!stays) {
+      slots_[i] = slots_[j];
+      slots_[j] = 0;
+      i = j;
+    }
+  }
+}
+
+void ProcessTable::Rehash(std::size_t slots) {
+  slots_.assign(slots, 0);
+  for (std::size_t row = 0; row < size(); ++row) {
+    slots_[Slot(pid_[row])] = static_cast<uint32_t>(row + 1);
+  }
+}
+
+void ProcessTable::Clear() {
+  Columns([this](auto column) { (this->*column).clear(); });
+  strings_.Clear();
+  std::fill(slots_.begin(), slots_.end(), 0);
+}
+
+void ProcessTable::Append(const ProcessTable& table, std::size_t row) {
+  std::size_t to = Add(table.pid_[row], table.startTime_[row]);
+  Columns([this, &table, row, to](auto column) {
+    (this->*column)[to] = (table.*column)[row];
+  });
+  command_[to] = strings_.Intern(table.strings_.Get(table.command_[row]));
+  user_[to] = strings_.Intern(table.strings_.Get(table.user_[row]));
+}
+
+void ProcessTable::Append(int pid, float cpuUtilization,
+                          std::string_view user, std::string_view command,
+                          const Process::Memory& ram, const Process::Io& io,
+                          long upTime) {
+  std::size_t row = Add(pid, 0);
+  flags_[row] = kSampled | kDetailsLoaded | (ram.accurate ? kAccurate : 0) |
+                (io.known ? kIoKnown : 0);
+  cpu_[row] = cpuUtilization;
+  user_[row] = strings_.Intern(user);
+  command_[row] = strings_.Intern(command);
+  rssKb_[row] = ram.rssKb;
+  sharedKb_[row] = ram.sharedKb;
+  pssKb_[row] = ram.pssKb;
+  swapKb_[row] = ram.swapKb;
+  readRate_[row] = io.readRate;
+  writeRate_[row] = io.writeRate;
+  upTime_[row] = upTime;
+}
+
+// Update the CPU utilization from the jiffies used since the previous sample
+// and the resident set size
+void ProcessTable::Sample(std::size_t row, const ProcParser::Stat& stat,
+                          uint64_t totalDelta, long uptime, uint64_t tick,
+                          const HostInfo& host) {
+  uint64_t activeJiffies = stat.utime + stat.stime;
+  bool sampled = flags_[row] & kSampled;
+  bool busy = !sampled || activeJiffies != jiffies_[row];
+  flags_[row] = (flags_[row] & ~kBusy) | (busy ? kBusy : 0);
+  state_[row] = stat.state;
+  ppid_[row] = stat.ppid;
+  readRate_[row] = writeRate_[row] = 0.0;
+  if (sampled && totalDelta > 0) {
+    // Counters of a live process never go backwards; clamp just in case
+    uint64_t used =
+        activeJiffies > jiffies_[row] ? activeJiffies - jiffies_[row] : 0;
+    cpu_[row] = static_cast<float>(used) / static_cast<float>(totalDelta);
+  } else {
+    // No previous sample yet: fall back to the lifetime average, scaled to
+    // the whole machine like the per-interval value
+    auto hertz = static_cast<float>(host.clockTicks);
+    auto cpus = static_cast<float>(host.onlineCpus);
+    float seconds = static_cast<float>(uptime) -
+                    static_cast<float>(startTime_[row]) / hertz;
+    cpu_[row] = seconds > 0 ? (static_cast<float>(activeJiffies) / hertz) /
+                                  seconds / cpus
+                            : 0.0f;
+  }
+  uint32_t commHash = Hash(stat.comm);
+  if (sampled && commHash != commHash_[row]) InvalidateDetails(row);
+  commHash_[row] = commHash;
+  threads_[row] = static_cast<int32_t>(stat.numThreads);
+  rssKb_[row] = static_cast<uint64_t>(std::max<int64_t>(stat.rss, 0)) *
+                static_cast<uint64_t>(host.pageKb);
+  jiffies_[row] = activeJiffies;
+  lastSeen_[row] = tick;
+  flags_[row] |= kSampled;
+}
+
+// The command line and user can't change for a given process image, so
+// /proc/[pid]/cmdline and status are only read once per pid and again
+// after an exec
+void ProcessTable::LoadIdentity(std::size_t row) {
+  if (flags_[row] & kDetailsLoaded) return;
+  int pid = pid_[row];
+  strings_.Release(command_[row]);
+  command_[row] = strings_.Intern(LinuxParser::Command(pid));
+  ProcParser::Status status;
+  if (ProcParser::ReadStatus(pid, status)) {
+    uid_[row] = status.uid;
+    strings_.Release(user_[row]);
+    user_[row] = strings_.Intern(LinuxParser::UserName(status.uid));
+  }
+  flags_[row] |= kDetailsLoaded;
+}
+
+// Read the display-only fields
+void ProcessTable::LoadDetails(std::size_t row, long uptime,
+                               const HostInfo& host, bool accurate) {
+  int pid = pid_[row];
+  LoadIdentity(row);
+  ProcParser::Statm statm;
+  if (ProcParser::ReadStatm(pid, statm)) {
+    auto pageKb = static_cast<uint64_t>(host.pageKb);
+    rssKb_[row] = statm.resident * pageKb;
+    sharedKb_[row] = statm.shared * pageKb;
+  }
+  // Walking the page tables is expensive, so PSS and swap lag a little;
+  // processes we may not inspect are retried at the same rate
+  bool due = rollupTick_[row] == 0 ||
+             lastSeen_[row] >= rollupTick_[row] + kRollupInterval;
+  if (accurate && due) {
+    rollupTick_[row] = lastSeen_[row];
+    ProcParser::SmapsRollup rollup;
+    if (ProcParser::ReadSmapsRollup(pid, rollup)) {
+      pssKb_[row] = rollup.pssKb;
+      swapKb_[row] = rollup.swapKb;
+      flags_[row] |= kAccurate;
+    }
+  }
+  upTime_[row] = uptime - static_cast<long>(startTime_[row] / host.clockTicks);
+}
+
+void ProcessTable::InvalidateDetails(std::size_t row) {
+  flags_[row] &= ~kDetailsLoaded;
+  match_[row] = kMatchUnknown;
+}
+
+bool ProcessTable::Matches(std::size_t row, const ProcessFilter& filter) {
+  if (match_[row] == kMatchUnknown) {
+    LoadIdentity(row);
+    match_[row] = filter.Matches(strings_.Get(user_[row]),
+                                 strings_.Get(command_[row]))
+                      ? kMatched
+                      : kFiltered;
+  }
+  return match_[row] == kMatched;
+}
+
+void ProcessTable::ResetMatches() {
+  std::fill(match_.begin(), match_.end(), kMatchUnknown);
+}
+
+uint32_t ProcessTable::LastRank(std::size_t row) const { return rank_[row]; }
+
+void ProcessTable::SetRank(std::size_t row, uint32_t rank) {
+  rank_[row] = rank;
+}
+
+bool ProcessTable::IoCandidate(std::size_t row) const {
+  return !(flags_[row] & kIoDenied) &&
+         (ioTick_[row] == 0 || (flags_[row] & kBusy) || state_[row] == 'D');
+}
+
+void ProcessTable::SampleIo(std::size_t row, double uptime) {
+  if ((flags_[row] & kIoDenied) || ioTick_[row] == lastSeen_[row]) return;
+  ProcParser::Io io;
+  int error = 0;
+  if (!ProcParser::ReadIo(pid_[row], io, &error)) {
+    // Not ours to inspect without root; don't try again. Other failures,
+    // e.g. a process exiting mid-read, are retried on the next tick.
+    flags_[row] &= ~kIoKnown;
+    if (error == EACCES || error == EPERM) flags_[row] |= kIoDenied;
+    readRate_[row] = writeRate_[row] = 0.0;
+    return;
+  }
+  uint64_t written = io.writeBytes > io.cancelledWriteBytes
+                         ? io.writeBytes - io.cancelledWriteBytes
+                         : 0;
+  double elapsed = uptime - ioUptime_[row];
+  if (ioTick_[row] != 0 && elapsed > 0) {
+    uint64_t read = ioRead_[row];
+    readRate_[row] = io.readBytes > read
+                         ? static_cast<float>((io.readBytes - read) / elapsed)
+                         : 0.0f;
+    writeRate_[row] =
+        written > ioWritten_[row]
+            ? static_cast<float>((written - ioWritten_[row]) / elapsed)
+            : 0.0f;
+    flags_[row] |= kIoKnown;
+  }
+  ioRead_[row] = io.readBytes;
+  ioWritten_[row] = written;
+  ioTick_[row] = lastSeen_[row];
+  ioUptime_[row] = uptime;
+}
+
+std::size_t ProcessTable::Bytes() const {
+  std::size_t bytes = strings_.Bytes() + slots_.capacity() * sizeof(uint32_t);
+  Columns([this, &bytes](auto column) {
+    bytes += (this->*column).capacity() * sizeof((this->*column)[0]);
+  });
+  return bytes;
+}
@@ -1,59 +1,55 @@
 #include "processor.h"
 
-Processor::Processor() {
-  auto ret = LinuxParser::CpuUtilization();
-  prev_user = ret[0];
-  prev_nice = ret[1];
-  prev_system = ret[2];
-  prev_idle = ret[3];
-  prev_iowait = ret[4];
-  prev_irq = ret[5];
-  prev_softirq = ret[6];
-  prev_steal = ret[7];
+#include <algorithm>
+
+using LinuxParser::CPUStates;
+
+// Reduce every slot of the snapshot to its total and idle jiffies, then
+// compute the utilization of all of them in one pass.
+// Guest and guest_nice are already included in user and nice, so they are
+// not added again.
+void Processor::Update(const SystemSnapshot& snapshot) {
+  const auto& times = snapshot.cpu;
+  const std::size_t slots = times.Slots();
+  const auto& s = times.states;
+  total_.resize(slots);
+  idle_.resize(slots);
+  // Straight passes over contiguous arrays, which the compiler can vectorize
+  for (std::size_t i = 0; i < slots; ++i) {
+    idle_[i] = s[CPUStates::kIdle_][i] + s[CPUStates::kIOwait_][i];
+    total_[i] = idle_[i] + s[CPUStates::kUser_][i] + s[CPUStates::kNice_][i] +
+                s[CPUStates::kSystem_][i] + s[CPUStates::kIRQ_][i] +
+                s[CPUStates::kSoftIRQ_][i] + s[CPUStates::kSteal_][i];
+  }
+
+  prevTotal_.resize(slots, 0);
+  prevIdle_.resize(slots, 0);
+  prevPresent_.resize(slots, 0);
+  utilization_.resize(slots);
+  for (std::size_t i = 0; i < slots; ++i) {
+    uint64_t totalDiff = total_[i] - prevTotal_[i];
+    uint64_t idleDiff = idle_[i] - prevIdle_[i];
+    // A CPU that went offline or came back, or counters that went
+    // backwards, produce no valid interval
+    bool valid = times.present[i] & prevPresent_[i] &
+                 (total_[i] >= prevTotal_[i]) & (idle_[i] >= prevIdle_[i]) &
+                 (idleDiff <= totalDiff);
+    float busy = static_cast<float>(totalDiff - idleDiff) /
+                 static_cast<float>(std::max<uint64_t>(totalDiff, 1));
+    utilization_[i] = valid ? busy : kOffline;
+  }
+
+  std::swap(prevTotal_, total_);
+  std::swap(prevIdle_, idle_);
+  prevPresent_ = times.present;
+
+  if (slots == 0) return;
+  cores_.assign(utilization_.begin() + 1, utilization_.end());
+  aggregate_ = std::max(0.0f, std::min(1.0f, utilization_[0]));
 }
 
 // Return the aggregate CPU utilization
-float Processor::Utilization() {
-  auto ret = LinuxParser::CpuUtilization();
-  uint64_t curr_user = ret[0];
-  uint64_t curr_nice = ret[1];
-  uint64_t curr_system = ret[2];
-  uint64_t curr_idle = ret[3];
-  uint64_t curr_iowait = ret[4];
-  uint64_t curr_irq = ret[5];
-  uint64_t curr_softirq = ret[6];
-  uint64_t curr_steal = ret[7];
-
-  // Calculate previous and current total idle times
-  uint64_t prev_total_idle = prev_idle + prev_iowait;
-  uint64_t curr_total_idle = curr_idle + curr_iowait;
-
-  // Calculate previous and current total non-idle times
-  uint64_t prev_total_non_idle = prev_user + prev_nice + prev_system +
-                                 prev_irq + prev_softirq + prev_steal;
-  uint64_t curr_total_non_idle = curr_user + curr_nice + curr_system +
-                                 curr_irq + curr_softirq + curr_steal;
-
-  // Calculate previous and current total times
-  uint64_t prev_total = prev_total_idle + prev_total_non_idle;
-  uint64_t curr_total = curr_total_idle + curr_total_non_idle;
-
-  // Calculate the differences
-  uint64_t total_diff = curr_total - prev_total;
-  uint64_t idle_diff = curr_total_idle - prev_total_idle;
-
-  // Calculate CPU percentage
-  auto diff = static_cast<float>(total_diff) - static_cast<float>(idle_diff);
-  float cpu_utilization = std::min(100.0f, diff / static_cast<float>(total_diff));
-
-  prev_user = curr_user;
-  prev_nice = curr_nice;
-  prev_system = curr_system;
-  prev_idle = curr_idle;
-  prev_iowait = curr_iowait;
-  prev_irq = curr_irq;
-  prev_softirq = curr_softirq;
-  prev_steal = curr_steal;
-
-  return cpu_utilization;
-}
\ No newline at end of file
+float Processor::Utilization() const { return aggregate_; }
+
+// Return the per-core CPU utilization, kOffline for CPUs without data
+const std::vector<float>& Processor::CoreUtilization() const { return cores_; }
@@ -0,0 +1,128 @@
+#include "sampler.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Collection may take up to 1/kCostShare of the sampling period
+constexpr int kCostShare = 4;
+}  // namespace
+
+Sampler::Sampler(System& system, std::size_t rows,
+                 std::chrono::milliseconds period, HistoryFile* history)
+    : system_(system),
+      rows_(rows),
+      period_(period),
+      history_(history),
+      notify_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      wakeup_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+Sampler::~Sampler() {
+  Stop();
+  if (notify_ >= 0) close(notify_);
+  if (wakeup_ >= 0) close(wakeup_);
+}
+
+// Publish a first snapshot synchronously, then keep sampling in the
+// background
+void Sampler::Start() {
+  if (thread_.joinable()) return;
+  Collect(buffers_.Back());
+  Publish();
+  stop_ = false;
+  if (wakeup_ >= 0) {
+    // Reset a wakeup left by an earlier Stop()
+    uint64_t count;
+    [[maybe_unused]] ssize_t n = read(wakeup_, &count, sizeof(count));
+  }
+  thread_ = std::thread(&Sampler::Run, this);
+}
+
+// Stop the sampling thread and wait for it to finish
+void Sampler::Stop() {
+  stop_ = true;
+  if (wakeup_ >= 0) {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = write(wakeup_, &one, sizeof(one));
+  }
+  if (thread_.joinable()) thread_.join();
+}
+
+// Return the most recently published snapshot
+const Snapshot& Sampler::Latest() { return buffers_.Front(); }
+
+int Sampler::NotifyFd() const { return notify_; }
+
+uint64_t Sampler::Unrecorded() const { return unrecorded_; }
+
+void Sampler::SortBy(System::SortKey key) { sortKey_ = key; }
+
+void Sampler::Expand(std::vector<int> pids) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  expand_ = std::move(pids);
+  expandChanged_ = true;
+}
+
+void Sampler::FilterBy(ProcessFilter filter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  filter_ = std::move(filter);
+  filterChanged_ = true;
+}
+
+void Sampler::GroupByCgroup(bool enabled, std::vector<int> expanded) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  grouped_ = enabled;
+  expandGroups_ = std::move(expanded);
+  groupsChanged_ = true;
+}
+
+bool Sampler::WakeOnStall(std::chrono::microseconds threshold) {
+  return triggers_.Open(threshold) > 0;
+}
+
+void Sampler::Run() {
+  using Clock = std::chrono::steady_clock;
+  auto next = Clock::now() + period_;
+  while (!stop_) {
+    bool stalled = triggers_.Wait(next, wakeup_);
+    if (stop_) break;
+    if (!stalled && Clock::now() < next) continue;
+    auto start = Clock::now();
+    Collect(buffers_.Back(), stalled);
+    Publish();
+    auto end = Clock::now();
+    // A stall sample comes on top of the cadence. Keep a fixed cadence,
+    // but don't try to catch up after a slow scan, and back off while
+    // collecting is expensive.
+    if (stalled) continue;
+    auto period =
+        std::max<Clock::duration>(period_, kCostShare * (end - start));
+    next = std::max(next + period, end);
+  }
+}
+
+void Sampler::Publish() {
+  buffers_.Publish();
+  if (notify_ >= 0) {
+    // Only fails once the counter saturates, i.e. nobody is reading it
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = write(notify_, &one, sizeof(one));
+  }
+}
+
+void Sampler::Collect(Snapshot& snapshot, bool stalled) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (expandChanged_) system_.Expand(expand_);
+    if (groupsChanged_) system_.GroupByCgroup(grouped_, expandGroups_);
+    if (filterChanged_) system_.FilterBy(filter_);
+    expandChanged_ = groupsChanged_ = filterChanged_ = false;
+  }
+  snapshot.Collect(system_, rows_, sortKey_);
+  snapshot.tick = ++tick_;
+  snapshot.stallTriggered = stalled;
+  if (history_ != nullptr && !history_->Append(snapshot)) ++unrecorded_;
+}
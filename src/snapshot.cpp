@@ -0,0 +1,46 @@
+#include "snapshot.h"
+
+#include <chrono>
+
+void Snapshot::Collect(System& system, std::size_t rows,
+                       System::SortKey key) {
+  system.Refresh();
+  time = std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+             .count();
+  operatingSystem = system.OperatingSystem();
+  kernel = system.Kernel();
+  cpuUtilization = system.Cpu().Utilization();
+  coreUtilization = system.Cpu().CoreUtilization();
+  memoryUtilization = system.MemoryUtilization();
+  swapUtilization = system.SwapUtilization();
+  totalProcesses = system.TotalProcesses();
+  runningProcesses = system.RunningProcesses();
+  blockedProcesses = system.BlockedProcesses();
+  loadAverage[0] = system.Snapshot().load1;
+  loadAverage[1] = system.Snapshot().load5;
+  loadAverage[2] = system.Snapshot().load15;
+  pressure = system.Pressure();
+  contextSwitches = system.Snapshot().contextSwitches;
+  interrupts = system.Snapshot().interrupts;
+  disks = system.Disks();
+  interfaces = system.Interfaces();
+  upTime = system.UpTime();
+  sortKey = key;
+  processes = system.Processes(rows, key);
+  filter = system.Filter().Text();
+  matchingProcesses = system.MatchingProcesses();
+  threads = system.Threads();
+  grouped = system.Grouped();
+  cgroupsAvailable = system.CgroupsAvailable();
+  if (grouped) {
+    groups = system.Groups();
+  } else {
+    groups.clear();
+  }
+  processEvents = system.ProcessEvents();
+  exitedProcesses = system.RecentExits().exited;
+  shortLivedProcesses = system.RecentExits().shortLived;
+  exitedCpuUtilization = system.RecentExits().cpuUtilization;
+  Instrument::Read(phases);
+}
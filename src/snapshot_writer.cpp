@@ -0,0 +1,384 @@
+#include "snapshot_writer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace {
+// Write out once this much is buffered or it has been held this long
+constexpr std::size_t kFlushSize = 256 * 1024;
+constexpr std::chrono::seconds kFlushInterval{1};
+
+template <typename T>
+void Put(std::string& buffer, T value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& buffer, std::string_view value) {
+  auto length = static_cast<uint16_t>(std::min<std::size_t>(value.size(),
+                                                             UINT16_MAX));
+  Put(buffer, length);
+  buffer.append(value.data(), length);
+}
+
+void AppendFormat(std::string& buffer, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// printf straight into the end of buffer
+void AppendFormat(std::string& buffer, const char* format, ...) {
+  char text[64];
+  va_list args, retry;
+  va_start(args, format);
+  va_copy(retry, args);
+  int n = std::vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (n > 0 && static_cast<std::size_t>(n) < sizeof(text)) {
+    buffer.append(text, n);
+  } else if (n > 0) {
+    // Too long for the scratch buffer: format again into the string itself
+    std::size_t size = buffer.size();
+    buffer.resize(size + n + 1);
+    std::vsnprintf(&buffer[size], n + 1, format, retry);
+    buffer.resize(size + n);
+  }
+  va_end(retry);
+}
+
+// Append value as a quoted JSON string
+void AppendJsonString(std::string& buffer, std::string_view value) {
+  buffer += '"';
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        buffer += "\\\"";
+        break;
+      case '\\':
+        buffer += "\\\\";
+        break;
+      case '\n':
+        buffer += "\\n";
+        break;
+      case '\t':
+        buffer += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          AppendFormat(buffer, "\\u%04x", c);
+        } else {
+          buffer += c;
+        }
+    }
+  }
+  buffer += '"';
+}
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(int fd, Options::Format format)
+    : fd_(fd), format_(format), lastFlush_(std::chrono::steady_clock::now()) {
+  buffer_.reserve(2 * kFlushSize);
+  if (format_ == Options::Format::kBinary) {
+    buffer_.append("SMON", 4);
+    Put(buffer_, kBinaryVersion);
+  }
+}
+
+SnapshotWriter::~SnapshotWriter() { Flush(); }
+
+bool SnapshotWriter::Write(const Snapshot& snapshot) {
+  if (format_ == Options::Format::kBinary) {
+    AppendBinary(snapshot);
+  } else {
+    AppendJson(snapshot);
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (buffer_.size() >= kFlushSize || now - lastFlush_ >= kFlushInterval) {
+    return Flush();
+  }
+  return true;
+}
+
+bool SnapshotWriter::Flush() {
+  lastFlush_ = std::chrono::steady_clock::now();
+  std::size_t written = 0;
+  while (written < buffer_.size()) {
+    ssize_t n = write(fd_, buffer_.data() + written, buffer_.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      buffer_.clear();
+      return false;
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  buffer_.clear();
+  return true;
+}
+
+void SnapshotWriter::AppendJson(const Snapshot& snapshot) {
+  AppendFormat(buffer_, "{\"tick\":%llu,\"time\":%lld",
+               static_cast<unsigned long long>(snapshot.tick),
+               static_cast<long long>(snapshot.time));
+  AppendFormat(buffer_, ",\"cpu\":%.4f,\"cores\":[", snapshot.cpuUtilization);
+  for (std::size_t i = 0; i < snapshot.coreUtilization.size(); ++i) {
+    AppendFormat(buffer_, i == 0 ? "%.4f" : ",%.4f",
+                 snapshot.coreUtilization[i]);
+  }
+  AppendFormat(buffer_, "],\"memory\":%.4f,\"swap\":%.4f",
+               snapshot.memoryUtilization, snapshot.swapUtilization);
+  AppendFormat(buffer_, ",\"total\":%d,\"running\":%d,\"blocked\":%d",
+               snapshot.totalProcesses, snapshot.runningProcesses,
+               snapshot.blockedProcesses);
+  AppendFormat(buffer_, ",\"uptime\":%ld", snapshot.upTime);
+  AppendFormat(buffer_, ",\"ctxt\":%llu",
+               static_cast<unsigned long long>(snapshot.contextSwitches));
+  AppendFormat(buffer_, ",\"intr\":%llu",
+               static_cast<unsigned long long>(snapshot.interrupts));
+  AppendFormat(buffer_, ",\"load\":[%.2f,%.2f,%.2f]", snapshot.loadAverage[0],
+               snapshot.loadAverage[1], snapshot.loadAverage[2]);
+  // Resources without PSI are left out
+  buffer_ += ",\"psi\":{";
+  bool first = true;
+  for (int resource = 0; resource < PressureStats::kResources; ++resource) {
+    const PressureStats::Pressure& pressure = snapshot.pressure[resource];
+    if (!pressure.available) continue;
+    AppendFormat(buffer_, "%s\"%s\":{", first ? "" : ",",
+                 PressureStats::Name(
+                     static_cast<PressureStats::Resource>(resource)));
+    const PressureStats::Stall* stalls[] = {&pressure.some, &pressure.full};
+    for (int i = 0; i < 2; ++i) {
+      AppendFormat(buffer_,
+                   "%s:{\"avg10\":%.4f,\"avg60\":%.4f,\"interval\":%.4f,"
+                   "\"total_us\":%llu}",
+                   i == 0 ? "\"some\"" : ",\"full\"", stalls[i]->avg10,
+                   stalls[i]->avg60, stalls[i]->interval,
+                   static_cast<unsigned long long>(stalls[i]->totalUs));
+    }
+    buffer_ += '}';
+    first = false;
+  }
+  buffer_ += '}';
+  if (snapshot.stallTriggered) buffer_ += ",\"stall_triggered\":true";
+  buffer_ += ",\"disks\":[";
+  first = true;
+  for (const auto& disk : snapshot.disks) {
+    buffer_ += first ? "{\"name\":" : ",{\"name\":";
+    AppendJsonString(buffer_, disk.name);
+    AppendFormat(buffer_,
+                 ",\"read_bps\":%.0f,\"write_bps\":%.0f,\"iops\":%.1f,"
+                 "\"util\":%.4f}",
+                 disk.readRate, disk.writeRate, disk.iops, disk.utilization);
+    first = false;
+  }
+  buffer_ += "],\"net\":[";
+  first = true;
+  for (const auto& interface : snapshot.interfaces) {
+    buffer_ += first ? "{\"name\":" : ",{\"name\":";
+    AppendJsonString(buffer_, interface.name);
+    AppendFormat(buffer_,
+                 ",\"rx_bps\":%.0f,\"tx_bps\":%.0f,\"rx_pps\":%.1f,"
+                 "\"tx_pps\":%.1f,\"errors\":%.1f,\"drops\":%.1f}",
+                 interface.rxRate, interface.txRate, interface.rxPackets,
+                 interface.txPackets, interface.errors, interface.drops);
+    first = false;
+  }
+  buffer_ += ']';
+  if (snapshot.grouped) {
+    // Unknown values are left out
+    buffer_ += ",\"groups\":[";
+    first = true;
+    for (const auto& group : snapshot.groups) {
+      AppendFormat(buffer_, "%s{\"id\":%d,\"path\":", first ? "" : ",",
+                   group.id);
+      AppendJsonString(buffer_, group.path);
+      AppendFormat(buffer_, ",\"procs\":%d,\"cpu\":%.4f", group.processes,
+                   group.cpuUtilization);
+      if (group.stallKnown)
+        AppendFormat(buffer_, ",\"cpu_stall\":%.4f", group.cpuStall);
+      if (group.memoryKnown) {
+        AppendFormat(buffer_, ",\"memory_bytes\":%llu",
+                     static_cast<unsigned long long>(group.memoryBytes));
+      }
+      if (group.ioKnown) {
+        AppendFormat(buffer_, ",\"read_bps\":%.0f,\"write_bps\":%.0f",
+                     group.readRate, group.writeRate);
+      }
+      buffer_ += '}';
+      first = false;
+    }
+    buffer_ += ']';
+  }
+  if (!snapshot.filter.empty()) {
+    buffer_ += ",\"filter\":";
+    AppendJsonString(buffer_, snapshot.filter);
+    AppendFormat(buffer_, ",\"matching\":%zu", snapshot.matchingProcesses);
+  }
+  buffer_ += ",\"processes\":[";
+  first = true;
+  for (const auto& process : snapshot.processes) {
+    AppendFormat(buffer_, "%s{\"pid\":%d,\"cpu\":%.4f", first ? "" : ",",
+                 process.Pid(), process.CpuUtilization());
+    buffer_ += ",\"user\":";
+    AppendJsonString(buffer_, process.User());
+    Process::Memory ram = process.Ram();
+    AppendFormat(buffer_, ",\"rss_kb\":%llu,\"shared_kb\":%llu",
+                 static_cast<unsigned long long>(ram.rssKb),
+                 static_cast<unsigned long long>(ram.sharedKb));
+    if (ram.accurate) {
+      AppendFormat(buffer_, ",\"pss_kb\":%llu,\"swap_kb\":%llu",
+                   static_cast<unsigned long long>(ram.pssKb),
+                   static_cast<unsigned long long>(ram.swapKb));
+    }
+    Process::Io io = process.DiskIo();
+    if (io.known) {
+      AppendFormat(buffer_, ",\"read_bps\":%.0f,\"write_bps\":%.0f",
+                   io.readRate, io.writeRate);
+    }
+    AppendFormat(buffer_, ",\"uptime\":%ld", process.UpTime());
+    buffer_ += ",\"command\":";
+    AppendJsonString(buffer_, process.Command());
+    buffer_ += '}';
+    first = false;
+  }
+  buffer_ += ']';
+  if (!snapshot.threads.empty()) {
+    buffer_ += ",\"threads\":[";
+    first = true;
+    for (const auto& thread : snapshot.threads) {
+      AppendFormat(buffer_,
+                   "%s{\"pid\":%d,\"tid\":%d,\"state\":\"%c\",\"cpu\":%.4f",
+                   first ? "" : ",", thread.pid, thread.tid, thread.state,
+                   thread.cpuUtilization);
+      buffer_ += ",\"name\":";
+      AppendJsonString(buffer_, thread.name);
+      buffer_ += '}';
+      first = false;
+    }
+    buffer_ += ']';
+  }
+  if (!snapshot.phases.empty()) {
+    buffer_ += ",\"phases\":{";
+    first = true;
+    for (const auto& phase : snapshot.phases) {
+      AppendFormat(buffer_,
+                   "%s\"%s\":{\"calls\":%llu,\"last_us\":%llu,"
+                   "\"p50_us\":%llu,\"p99_us\":%llu",
+                   first ? "" : ",", Instrument::Name(phase.phase),
+                   static_cast<unsigned long long>(phase.calls),
+                   static_cast<unsigned long long>(phase.lastUs),
+                   static_cast<unsigned long long>(phase.p50Us),
+                   static_cast<unsigned long long>(phase.p99Us));
+      AppendFormat(buffer_,
+                   ",\"syscalls\":%llu,\"bytes\":%llu,\"allocs\":%llu,"
+                   "\"processes\":%llu}",
+                   static_cast<unsigned long long>(phase.counters[0]),
+                   static_cast<unsigned long long>(phase.counters[1]),
+                   static_cast<unsigned long long>(phase.counters[2]),
+                   static_cast<unsigned long long>(phase.counters[3]));
+      first = false;
+    }
+    buffer_ += '}';
+  }
+  buffer_ += "}\n";
+}
+
+void SnapshotWriter::AppendBinary(const Snapshot& snapshot) {
+  std::size_t start = buffer_.size();
+  Put(buffer_, uint32_t{0});  // length, patched below
+  Put(buffer_, static_cast<uint64_t>(snapshot.tick));
+  Put(buffer_, static_cast<int64_t>(snapshot.time));
+  Put(buffer_, snapshot.cpuUtilization);
+  Put(buffer_, snapshot.memoryUtilization);
+  Put(buffer_, snapshot.swapUtilization);
+  Put(buffer_, static_cast<uint32_t>(snapshot.totalProcesses));
+  Put(buffer_, static_cast<uint32_t>(snapshot.runningProcesses));
+  Put(buffer_, static_cast<uint32_t>(snapshot.blockedProcesses));
+  Put(buffer_, static_cast<int64_t>(snapshot.upTime));
+  Put(buffer_, static_cast<uint64_t>(snapshot.contextSwitches));
+  Put(buffer_, static_cast<uint64_t>(snapshot.interrupts));
+  Put(buffer_, static_cast<uint16_t>(snapshot.coreUtilization.size()));
+  for (float core : snapshot.coreUtilization) Put(buffer_, core);
+  for (float load : snapshot.loadAverage) Put(buffer_, load);
+  Put(buffer_, static_cast<uint8_t>(snapshot.stallTriggered));
+  for (const auto& pressure : snapshot.pressure) {
+    Put(buffer_, static_cast<uint8_t>(pressure.available));
+    for (const auto* stall : {&pressure.some, &pressure.full}) {
+      Put(buffer_, stall->avg10);
+      Put(buffer_, stall->avg60);
+      Put(buffer_, stall->interval);
+      Put(buffer_, static_cast<uint64_t>(stall->totalUs));
+    }
+  }
+  Put(buffer_, static_cast<uint16_t>(snapshot.disks.size()));
+  for (const auto& disk : snapshot.disks) {
+    PutString(buffer_, disk.name);
+    Put(buffer_, disk.readRate);
+    Put(buffer_, disk.writeRate);
+    Put(buffer_, disk.iops);
+    Put(buffer_, disk.utilization);
+  }
+  Put(buffer_, static_cast<uint16_t>(snapshot.interfaces.size()));
+  for (const auto& interface : snapshot.interfaces) {
+    PutString(buffer_, interface.name);
+    Put(buffer_, interface.rxRate);
+    Put(buffer_, interface.txRate);
+    Put(buffer_, interface.rxPackets);
+    Put(buffer_, interface.txPackets);
+    Put(buffer_, interface.errors);
+    Put(buffer_, interface.drops);
+  }
+  // A group's known values are flagged: 1 memory, 2 io, 4 cpu stall
+  Put(buffer_, static_cast<uint8_t>(snapshot.grouped));
+  Put(buffer_, static_cast<uint32_t>(snapshot.groups.size()));
+  for (const auto& group : snapshot.groups) {
+    Put(buffer_, static_cast<int32_t>(group.id));
+    PutString(buffer_, group.path);
+    Put(buffer_, static_cast<uint32_t>(group.processes));
+    Put(buffer_, static_cast<uint8_t>(group.memoryKnown | group.ioKnown << 1 |
+                                      group.stallKnown << 2));
+    Put(buffer_, group.cpuUtilization);
+    Put(buffer_, group.cpuStall);
+    Put(buffer_, static_cast<uint64_t>(group.memoryBytes));
+    Put(buffer_, group.readRate);
+    Put(buffer_, group.writeRate);
+  }
+  Put(buffer_, static_cast<uint32_t>(snapshot.processes.size()));
+  for (const auto& process : snapshot.processes) {
+    Put(buffer_, static_cast<int32_t>(process.Pid()));
+    Put(buffer_, process.CpuUtilization());
+    Process::Memory ram = process.Ram();
+    Put(buffer_, static_cast<uint64_t>(ram.rssKb));
+    Put(buffer_, static_cast<uint64_t>(ram.sharedKb));
+    Put(buffer_, static_cast<uint64_t>(ram.accurate ? ram.pssKb : 0));
+    Put(buffer_, static_cast<uint64_t>(ram.accurate ? ram.swapKb : 0));
+    Process::Io io = process.DiskIo();
+    Put(buffer_, io.known ? io.readRate : -1.0f);
+    Put(buffer_, io.known ? io.writeRate : -1.0f);
+    Put(buffer_, static_cast<int64_t>(process.UpTime()));
+    PutString(buffer_, process.User());
+    PutString(buffer_, process.Command());
+  }
+  Put(buffer_, static_cast<uint32_t>(snapshot.threads.size()));
+  for (const auto& thread : snapshot.threads) {
+    Put(buffer_, static_cast<int32_t>(thread.pid));
+    Put(buffer_, static_cast<int32_t>(thread.tid));
+    Put(buffer_, static_cast<uint8_t>(thread.state));
+    Put(buffer_, thread.cpuUtilization);
+    PutString(buffer_, thread.name);
+  }
+  Put(buffer_, static_cast<uint8_t>(snapshot.phases.size()));
+  for (const auto& phase : snapshot.phases) {
+    Put(buffer_, static_cast<uint8_t>(phase.phase));
+    Put(buffer_, static_cast<uint64_t>(phase.calls));
+    Put(buffer_, static_cast<uint64_t>(phase.lastUs));
+    Put(buffer_, static_cast<uint64_t>(phase.p50Us));
+    Put(buffer_, static_cast<uint64_t>(phase.p99Us));
+    for (uint64_t counter : phase.counters) Put(buffer_, counter);
+  }
+  auto length =
+      static_cast<uint32_t>(buffer_.size() - start - sizeof(uint32_t));
+  std::memcpy(&buffer_[start], &length, sizeof(length));
+}
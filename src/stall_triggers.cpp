@@ -0,0 +1,73 @@
+#include "stall_triggers.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "linux_parser.h"
+
+StallTriggers::~StallTriggers() { Close(); }
+
+std::size_t StallTriggers::Open(std::chrono::microseconds threshold) {
+  Close();
+  static const std::string* const files[] = {
+      &LinuxParser::kPressureCpuFilename,
+      &LinuxParser::kPressureMemoryFilename,
+      &LinuxParser::kPressureIoFilename,
+  };
+  char trigger[64];
+  int length = std::snprintf(
+      trigger, sizeof(trigger), "some %lld %lld",
+      static_cast<long long>(threshold.count()),
+      static_cast<long long>(
+          std::chrono::microseconds(kWindow).count()));
+  for (const std::string* file : files) {
+    std::string path = LinuxParser::ProcDirectory() + *file;
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) continue;
+    // The kernel expects the terminating NUL to be written too
+    if (write(fd, trigger, length + 1) < 0) {
+      close(fd);
+      continue;
+    }
+    fds_.push_back(fd);
+  }
+  return fds_.size();
+}
+
+void StallTriggers::Close() {
+  for (int fd : fds_) close(fd);
+  fds_.clear();
+}
+
+bool StallTriggers::Active() const { return !fds_.empty(); }
+
+bool StallTriggers::Wait(std::chrono::steady_clock::time_point deadline,
+                         int wake) {
+  // Stack storage for the wake descriptor and the three triggers
+  pollfd fds[4];
+  nfds_t count = 0;
+  if (wake >= 0) fds[count++] = {wake, POLLIN, 0};
+  for (int fd : fds_) fds[count++] = {fd, POLLPRI, 0};
+  auto now = std::chrono::steady_clock::now();
+  if (now >= deadline) return false;
+  // Round up so a deadline less than a millisecond away doesn't spin
+  auto timeout = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+  if (poll(fds, count, static_cast<int>(timeout.count())) <= 0) return false;
+  bool stalled = false;
+  nfds_t first = wake >= 0 ? 1 : 0;
+  for (nfds_t i = count; i-- > first;) {
+    if (fds[i].revents & (POLLERR | POLLNVAL)) {
+      // A broken trigger would wake every poll from now on
+      close(fds[i].fd);
+      fds_.erase(fds_.begin() + (i - first));
+    } else if (fds[i].revents & POLLPRI) {
+      stalled = true;
+    }
+  }
+  return stalled;
+}
@@ -0,0 +1,139 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr std::size_t kInitialSlots = 16;
+// Dead bytes below this aren't worth a compaction
+constexpr std::size_t kMinCompact = 4096;
+
+// FNV-1a
+uint32_t Hash(std::string_view text) {
+  uint32_t hash = 2166136261u;
+  for (char c : text) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  return hash;
+}
+}  // namespace
+
+StringPool::StringPool()
+    : chars_(1, '\0'), entries_(1, Entry{0, 0, 0, 0}), slots_(kInitialSlots) {}
+
+std::size_t StringPool::Slot(std::string_view text, uint32_t hash) const {
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+    uint32_t id = slots_[i];
+    if (id == 0) return i;
+    const Entry& entry = entries_[id];
+    if (entry.hash == hash && entry.length == text.size() &&
+        std::memcmp(&chars_[entry.offset], text.data(), text.size()) == 0)
+      return i;
+  }
+}
+
+uint32_t StringPool::Intern(std::string_view text) {
+  if (text.empty()) return 0;
+  uint32_t hash = Hash(text);
+  std::size_t slot = Slot(text, hash);
+  if (slots_[slot] != 0) {
+    ++entries_[slots_[slot]].refs;
+    return slots_[slot];
+  }
+  if ((live_ + 1) * 2 > slots_.size()) {
+    Rehash(slots_.size() * 2);
+    slot = Slot(text, hash);
+  }
+  uint32_t id;
+  if (!free_.empty()) {
+    id = free_.back();
+    free_.pop_back();
+  } else {
+    id = static_cast<uint32_t>(entries_.size());
+    entries_.emplace_back();
+  }
+  entries_[id] = {static_cast<uint32_t>(chars_.size()),
+                  static_cast<uint32_t>(text.size()), 1, hash};
+  chars_.insert(chars_.end(), text.begin(), text.end());
+  chars_.push_back('\0');
+  slots_[slot] = id;
+  ++live_;
+  return id;
+}
+
+void StringPool::Retain(uint32_t id) {
+  if (id != 0) ++entries_[id].refs;
+}
+
+void StringPool::Release(uint32_t id) {
+  if (id == 0 || --entries_[id].refs > 0) return;
+  Unlink(id);
+  deadBytes_ += entries_[id].length + 1;
+  entries_[id].length = 0;
+  free_.push_back(id);
+  --live_;
+  if (deadBytes_ >= kMinCompact && deadBytes_ * 2 > chars_.size()) Compact();
+}
+
+// Remove id from slots_, shifting back the entries probed past it so
+// lookups never stop short at the hole
+void StringPool::Unlink(uint32_t id) {
+  std::size_t mask = slots_.size() - 1;
+  std::size_t i = entries_[id].hash & mask;
+  while (slots_[i] != id) i = (i + 1) & mask;
+  slots_[i] = 0;
+  for (std::size_t j = (i + 1) & mask; slots_[j] != 0; j = (j + 1) & mask) {
+    std::size_t home = entries_[slots_[j]].hash & mask;
+    // An entry stays if its home slot lies cyclically in (i, j]
+    bool stays = i <= j ? i < home && home <= j : i < home || home <= j;
+    if (!stays) {
+      slots_[i] = slots_[j];
+      slots_[j] = 0;
+      i = j;
+    }
+  }
+}
+
+void StringPool::Rehash(std::size_t slots) {
+  slots_.assign(slots, 0);
+  std::size_t mask = slots - 1;
+  for (uint32_t id = 1; id < entries_.size(); ++id) {
+    if (entries_[id].refs == 0) continue;
+    std::size_t i = entries_[id].hash & mask;
+    while (slots_[i] != 0) i = (i + 1) & mask;
+    slots_[i] = id;
+  }
+}
+
+// Copy the live strings into a fresh arena; ids and the index are kept
+void StringPool::Compact() {
+  std::vector<char> chars;
+  chars.reserve(chars_.size() - deadBytes_);
+  chars.push_back('\0');
+  for (uint32_t id = 1; id < entries_.size(); ++id) {
+    Entry& entry = entries_[id];
+    if (entry.refs == 0) continue;
+    const char* text = &chars_[entry.offset];
+    entry.offset = static_cast<uint32_t>(chars.size());
+    chars.insert(chars.end(), text, text + entry.length + 1);
+  }
+  chars_.swap(chars);
+  deadBytes_ = 0;
+}
+
+const char* StringPool::Get(uint32_t id) const {
+  return &chars_[entries_[id].offset];
+}
+
+void StringPool::Clear() {
+  chars_.resize(1);
+  entries_.resize(1);
+  free_.clear();
+  std::fill(slots_.begin(), slots_.end(), 0);
+  live_ = 0;
+  deadBytes_ = 0;
+}
+
+std::size_t StringPool::Bytes() const {
+  return chars_.capacity() + entries_.capacity() * sizeof(Entry) +
+         (free_.capacity() + slots_.capacity()) * sizeof(uint32_t);
+}
@@ -1,10 +1,16 @@
 #include "system.h"
 
+#include <algorithm>
 #include <set>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "instrument.h"
 #include "linux_parser.h"
+#include "proc_file_cache.h"
+#include "proc_parser.h"
 #include "process.h"
 #include "processor.h"
 
@@ -13,42 +19,447 @@ using std::size_t;
 using std::string;
 using std::vector;
 
-System::System()
-    : cpu_(Processor()),
-      kernel_(LinuxParser::Kernel()),
-      operatingSystem_(LinuxParser::OperatingSystem()) {
+namespace {
+// PIDs claimed by a worker at a time
+constexpr std::size_t kCollectChunk = 128;
+
+// Ticks between full /proc scans while process events are trusted
+constexpr uint64_t kScanInterval = 30;
+
+// Element moves per ranked process an incremental ranking may take before
+// falling back to a full sort
+constexpr std::size_t kShiftBudget = 4;
+
+// Return the key a process is ranked by, descending
+double RankKey(const Process& process, System::SortKey key) {
+  switch (key) {
+    case System::SortKey::kMemory:
+      return process.Ram().rssKb;
+    case System::SortKey::kIo: {
+      Process::Io io = process.DiskIo();
+      return io.readRate + io.writeRate;
+    }
+    case System::SortKey::kPid:
+      return -process.Pid();
+    case System::SortKey::kTime:
+      return -static_cast<double>(process.StartTime());
+    case System::SortKey::kCpu:
+      break;
+  }
+  return process.CpuUtilization();
+}
+
+// Sort ranks by insertion, which is linear on a nearly sorted input; stop
+// and return false once more than budget elements had to move
+template <typename It, typename Less>
+bool InsertionSort(It begin, It end, std::size_t budget, Less less) {
+  if (begin == end) return true;
+  for (It i = begin + 1; i != end; ++i) {
+    auto value = *i;
+    It j = i;
+    for (; j != begin && less(value, *(j - 1)); --j) {
+      if (budget-- == 0) {
+        *j = value;
+        return false;
+      }
+      *j = *(j - 1);
+    }
+    *j = value;
+  }
+  return true;
+}
+
+// Return the order of groups for key, ties broken by CPU utilization
+bool GroupOrder(const CgroupTable::Group& a, const CgroupTable::Group& b,
+                System::SortKey key) {
+  if (key == System::SortKey::kMemory && a.memoryBytes != b.memoryBytes)
+    return a.memoryBytes > b.memoryBytes;
+  if (key == System::SortKey::kIo) {
+    float x = a.readRate + a.writeRate;
+    float y = b.readRate + b.writeRate;
+    if (x != y) return x > y;
+  }
+  return a.cpuUtilization > b.cpuUtilization;
+}
+}  // namespace
+
+System::System(std::size_t threads, bool processEvents)
+    : pool_(threads), samples_(pool_.Size()) {
+  if (processEvents) events_.Start();
+  Refresh();
+}
+
+// Take a new snapshot of the global proc files and advance the CPU deltas
+void System::Refresh() {
+  {
+    INSTRUMENT_SCOPE(kSnapshot);
+    snapshot_.Read();
+    if (hostAge_ == 0) host_.Read();
+    hostAge_ = (hostAge_ + 1) % HostInfo::kRefreshInterval;
+    elapsed_ = prevUptime_ > 0 ? snapshot_.uptime - prevUptime_ : 0;
+    prevUptime_ = snapshot_.uptime;
+    disks_.Read(elapsed_);
+    net_.Read(elapsed_);
+    pressure_.Read(elapsed_);
+  }
+  INSTRUMENT_SCOPE(kCpu);
+  uint64_t jiffies = snapshot_.Jiffies();
+  jiffiesDelta_ = prevJiffies_ > 0 && jiffies > prevJiffies_
+                      ? jiffies - prevJiffies_
+                      : 0;
+  prevJiffies_ = jiffies;
+  cpu_.Update(snapshot_);
+}
+
+// Return the snapshot taken by the last Refresh()
+const SystemSnapshot& System::Snapshot() const { return snapshot_; }
+
+// Return the block devices read by the last Refresh()
+const std::vector<DiskStats::Device>& System::Disks() const {
+  return disks_.Devices();
+}
+
+// Return the network interfaces read by the last Refresh()
+const std::vector<NetStats::Interface>& System::Interfaces() const {
+  return net_.Interfaces();
+}
+
+// Return the pressure read by the last Refresh()
+const PressureStats::Pressures& System::Pressure() const {
+  return pressure_.Values();
 }
 
 // Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
 // Return a container composed of the system's processes
-vector<Process>& System::Processes() {
-  processes_.clear();
-  std::vector<int> pids = LinuxParser::Pids();
+const ProcessTable& System::Processes(std::size_t rows, SortKey key) {
+  uint64_t totalDelta = jiffiesDelta_;
+  long uptime = UpTime();
+  ++tick_;
+
+  // With process events the PIDs are the known ones plus those that were
+  // started; /proc is only rescanned periodically or after events were lost
+  {
+    INSTRUMENT_SCOPE(kEnumerate);
+    events_.Drain(batch_);
+    // Grouping needs the complete list every tick to count members
+    if (grouped_ || batch_.lost || lastScan_ == 0 ||
+        tick_ - lastScan_ >= kScanInterval) {
+      pidEnumerator_.Read(pids_);
+      lastScan_ = tick_;
+    } else {
+      pids_.clear();
+      for (const Process& process : table_) pids_.push_back(process.Pid());
+      pids_.insert(pids_.end(), batch_.started.begin(), batch_.started.end());
+      std::sort(pids_.begin(), pids_.end());
+      pids_.erase(std::unique(pids_.begin(), pids_.end()), pids_.end());
+    }
+  }
 
-  for (int pid : pids) {
-    processes_.emplace_back(pid);
+  // Group totals come from the cgroup files; of the processes, only the
+  // members of expanded groups are sampled below
+  if (grouped_) {
+    INSTRUMENT_SCOPE(kCgroups);
+    cgroups_.Update(pids_, elapsed_, host_.onlineCpus, expandedGroups_);
+    INSTRUMENT_COUNT(kProcesses, cgroups_.Groups().size());
+    pids_.clear();
+    cgroups_.Members(expandedGroups_, pids_);
   }
 
-  std::sort(processes_.rbegin(), processes_.rend());
+  // Read /proc/[pid]/stat in parallel; each worker appends to its own slice
+  {
+    INSTRUMENT_SCOPE(kParse);
+    INSTRUMENT_COUNT(kProcesses, pids_.size());
+    for (auto& slice : samples_) slice.clear();
+    pool_.ParallelFor(pids_.size(), kCollectChunk,
+                      [this](std::size_t begin, std::size_t end,
+                             std::size_t worker) {
+                        auto& slice = samples_[worker];
+                        for (std::size_t i = begin; i < end; ++i) {
+                          slice.push_back({pids_[i], {}});
+                          // Drop processes that exited mid-scan
+                          if (!ProcParser::ReadStat(pids_[i],
+                                                    slice.back().stat)) {
+                            slice.pop_back();
+                          }
+                        }
+                      });
+  }
+
+  {
+    INSTRUMENT_SCOPE(kUpdate);
+    for (const auto& slice : samples_) {
+      for (const auto& sample : slice) {
+        const auto& stat = sample.stat;
+        std::size_t row = table_.Find(sample.pid);
+        if (row == ProcessTable::npos) {
+          row = table_.Add(sample.pid, stat.startTime);
+        } else if (table_[row].StartTime() != stat.startTime) {
+          // The pid was reused by a new process
+          table_.Reset(row, stat.startTime);
+        }
+        table_.Sample(row, stat, totalDelta, uptime, tick_, host_);
+      }
+    }
+
+    // Exec events catch what the comm check in Sample() misses, such as a
+    // binary re-executing itself
+    for (int pid : batch_.execed) {
+      std::size_t row = table_.Find(pid);
+      if (row != ProcessTable::npos) table_.InvalidateDetails(row);
+    }
+    // Exits of processes that weren't sampled can't be told from
+    // short-lived ones, so they aren't accounted while grouping
+    if (grouped_) {
+      exits_ = {};
+    } else {
+      AccountExits(totalDelta);
+    }
+
+    // Evict processes that have exited since the previous tick
+    // Backwards, since the last row moves into a removed one
+    for (std::size_t row = table_.size(); row-- > 0;) {
+      if (table_[row].LastSeen() != tick_) {
+        ProcFileCache::Instance().Evict(table_[row].Pid());
+        table_.Remove(row);
+      }
+    }
+  }
+
+  // Match the processes against the filter before anything else is read
+  // for them; the command and user of a process are only loaded once, and
+  // the outcome is kept until it execs
+  if (!filter_.Empty()) {
+    INSTRUMENT_SCOPE(kFilter);
+    for (std::size_t row = 0; row < table_.size(); ++row) {
+      table_.Matches(row, filter_);
+    }
+  }
+
+  // Read the io files of the matching processes that ran, in parallel
+  {
+    INSTRUMENT_SCOPE(kIo);
+    ioCandidates_.clear();
+    for (std::size_t row = 0; row < table_.size(); ++row) {
+      if (table_.IoCandidate(row) &&
+          (filter_.Empty() || table_.Matches(row, filter_))) {
+        ioCandidates_.push_back(row);
+      }
+    }
+    INSTRUMENT_COUNT(kProcesses, ioCandidates_.size());
+    pool_.ParallelFor(ioCandidates_.size(), kCollectChunk,
+                      [this](std::size_t begin, std::size_t end, std::size_t) {
+                        for (std::size_t i = begin; i < end; ++i)
+                          table_.SampleIo(ioCandidates_[i], snapshot_.uptime);
+                      });
+  }
+
+  // Rank everything by the cheap sort key, then load the expensive fields
+  // only for the rows that are returned
+  {
+    INSTRUMENT_SCOPE(kSort);
+    RankProcesses(key);
+    rows = std::min(rows, ranking_.size());
+    if (grouped_) {
+      auto& groups = cgroups_.Groups();
+      std::sort(
+          groups.begin(), groups.end(),
+          [key](const CgroupTable::Group& a, const CgroupTable::Group& b) {
+            return GroupOrder(a, b, key);
+          });
+    }
+  }
+
+  {
+    INSTRUMENT_SCOPE(kDetails);
+    processes_.Clear();
+    for (std::size_t i = 0; i < rows; ++i) {
+      std::size_t row = ranking_[i].row;
+      table_.LoadDetails(row, uptime, host_, accurateMemory_);
+      table_.SampleIo(row, snapshot_.uptime);
+      processes_.Append(table_, row);
+    }
+  }
+  UpdateThreads(totalDelta);
   return processes_;
 }
 
+// Sample the threads of the expanded processes that are still alive and
+// drop the tables of the others
+void System::UpdateThreads(uint64_t totalDelta) {
+  INSTRUMENT_SCOPE(kThreads);
+  threads_.clear();
+  for (auto it = tasks_.begin(); it != tasks_.end();) {
+    std::size_t row = table_.Find(it->first);
+    bool expanded = std::find(expanded_.begin(), expanded_.end(),
+                              it->first) != expanded_.end();
+    if (!expanded || row == ProcessTable::npos ||
+        table_[row].StartTime() != it->second.StartTime()) {
+      it = tasks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (int pid : expanded_) {
+    std::size_t row = table_.Find(pid);
+    if (row == ProcessTable::npos) continue;
+    Process process = table_[row];
+    auto it = tasks_.find(pid);
+    if (it == tasks_.end()) {
+      it = tasks_
+               .emplace(std::piecewise_construct, std::forward_as_tuple(pid),
+                        std::forward_as_tuple(pid, process.StartTime()))
+               .first;
+    }
+    it->second.Update(process, totalDelta);
+    const auto& threads = it->second.Threads();
+    threads_.insert(threads_.end(), threads.begin(), threads.end());
+  }
+}
+
+const ProcessTable& System::Table() const { return table_; }
+
+void System::FilterBy(ProcessFilter filter) {
+  filter_ = std::move(filter);
+  table_.ResetMatches();
+  resort_ = true;
+}
+
+const ProcessFilter& System::Filter() const { return filter_; }
+
+std::size_t System::MatchingProcesses() const { return ranking_.size(); }
+
+// Order the matching rows by key. Between two ticks most processes keep
+// their rank, so the rows are laid out in the order of the last ranking,
+// with new ones after them, and sorted by insertion; only a changed key
+// or filter, or an order that changed a lot, takes a full sort.
+void System::RankProcesses(SortKey key) {
+  std::size_t ranked = ranking_.size();
+  constexpr uint32_t kHole = ProcessTable::kUnranked;
+  ranking_.assign(ranked, Rank{0, 0, kHole});
+  unranked_.clear();
+  for (std::size_t row = 0; row < table_.size(); ++row) {
+    if (!filter_.Empty() && !table_.Matches(row, filter_)) {
+      table_.SetRank(row, ProcessTable::kUnranked);
+      continue;
+    }
+    Process process = table_[row];
+    Rank rank{RankKey(process, key), process.CpuUtilization(),
+              static_cast<uint32_t>(row)};
+    uint32_t last = table_.LastRank(row);
+    if (last < ranked) {
+      ranking_[last] = rank;
+    } else {
+      unranked_.push_back(rank);
+    }
+  }
+  ranking_.erase(std::remove_if(ranking_.begin(), ranking_.end(),
+                                [](const Rank& rank) {
+                                  return rank.row == kHole;
+                                }),
+                 ranking_.end());
+  ranking_.insert(ranking_.end(), unranked_.begin(), unranked_.end());
+
+  // Descending, ties broken by CPU utilization
+  auto before = [](const Rank& a, const Rank& b) {
+    return a.key != b.key ? a.key > b.key : a.cpu > b.cpu;
+  };
+  if (resort_ || key != rankedBy_ ||
+      !InsertionSort(ranking_.begin(), ranking_.end(),
+                     kShiftBudget * ranking_.size(), before)) {
+    std::sort(ranking_.begin(), ranking_.end(), before);
+  }
+  for (std::size_t i = 0; i < ranking_.size(); ++i) {
+    table_.SetRank(ranking_[i].row, static_cast<uint32_t>(i));
+  }
+  rankedBy_ = key;
+  resort_ = false;
+}
+
+void System::AccurateMemory(bool enabled) { accurateMemory_ = enabled; }
+
+void System::Expand(std::vector<int> pids) { expanded_ = std::move(pids); }
+
+const std::vector<int>& System::Expanded() const { return expanded_; }
+
+const std::vector<TaskTable::Thread>& System::Threads() const {
+  return threads_;
+}
+
+void System::GroupByCgroup(bool enabled, std::vector<int> expanded) {
+  // Only members of expanded groups are in the table, so leaving grouping
+  // needs a full scan
+  if (grouped_ && !enabled) lastScan_ = 0;
+  grouped_ = enabled;
+  expandedGroups_ = std::move(expanded);
+}
+
+bool System::Grouped() const { return grouped_; }
+
+bool System::CgroupsAvailable() const { return cgroups_.Available(); }
+
+const std::vector<CgroupTable::Group>& System::Groups() const {
+  return cgroups_.Groups();
+}
+
+// Add up the CPU time that exited processes used after their last sample,
+// including processes that never lived through a tick
+void System::AccountExits(uint64_t totalDelta) {
+  exits_ = {};
+  uint64_t jiffies = 0;
+  for (const auto& exit : batch_.exited) {
+    ++exits_.exited;
+    std::size_t row = table_.Find(exit.pid);
+    if (row != ProcessTable::npos &&
+        table_[row].StartTime() == exit.startTime) {
+      uint64_t sampled = table_[row].ActiveJiffies();
+      if (exit.activeJiffies > sampled) jiffies += exit.activeJiffies - sampled;
+    } else {
+      ++exits_.shortLived;
+      jiffies += exit.activeJiffies;
+    }
+  }
+  if (totalDelta > 0) {
+    exits_.cpuUtilization =
+        static_cast<float>(jiffies) / static_cast<float>(totalDelta);
+  }
+}
+
+// Return true if processes are tracked through kernel process events
+bool System::ProcessEvents() const { return events_.Active(); }
+
+// Return the processes that exited during the last tick
+const System::Exits& System::RecentExits() const { return exits_; }
+
 // Return the system's kernel identifier (string)
-std::string System::Kernel() const { return kernel_; }
+std::string System::Kernel() const { return host_.kernel; }
 
 // Return the system's memory utilization
-float System::MemoryUtilization() { return LinuxParser::MemoryUtilization(); }
+float System::MemoryUtilization() const {
+  return snapshot_.MemoryUtilization();
+}
+
+// Return the system's swap utilization
+float System::SwapUtilization() const { return snapshot_.SwapUtilization(); }
 
 // Return the operating system name
-std::string System::OperatingSystem() const { return operatingSystem_; }
+std::string System::OperatingSystem() const {
+  return host_.operatingSystem;
+}
 
 // Return the number of processes actively running on the system
-int System::RunningProcesses() { return LinuxParser::RunningProcesses(); }
+int System::RunningProcesses() const {
+  return static_cast<int>(snapshot_.procsRunning);
+}
+
+// Return the number of processes blocked waiting for I/O
+int System::BlockedProcesses() const {
+  return static_cast<int>(snapshot_.procsBlocked);
+}
 
-// Return the total number of processes on the system
-int System::TotalProcesses() { return LinuxParser::TotalProcesses(); }
+// Return the total number of processes created since boot
+int System::TotalProcesses() const { return static_cast<int>(snapshot_.forks); }
 
 // Return the number of seconds since the system started running
-long int System::UpTime() { return LinuxParser::UpTime(); }
\ No newline at end of file
+long int System::UpTime() const { return static_cast<long>(snapshot_.uptime); }
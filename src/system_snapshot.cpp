@@ -0,0 +1,165 @@
+#include "system_snapshot.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "proc_file_cache.h"
+
+namespace {
+template <typename Member>
+struct Field {
+  const char* key;
+  Member SystemSnapshot::*member;
+};
+
+const Field<uint64_t> kStatFields[] = {
+    {"intr", &SystemSnapshot::interrupts},
+    {"ctxt", &SystemSnapshot::contextSwitches},
+    {"btime", &SystemSnapshot::bootTime},
+    {"processes", &SystemSnapshot::forks},
+    {"procs_running", &SystemSnapshot::procsRunning},
+    {"procs_blocked", &SystemSnapshot::procsBlocked},
+};
+
+const Field<uint64_t> kMeminfoFields[] = {
+    {"MemTotal", &SystemSnapshot::memTotal},
+    {"MemFree", &SystemSnapshot::memFree},
+    {"MemAvailable", &SystemSnapshot::memAvailable},
+    {"Buffers", &SystemSnapshot::buffers},
+    {"Cached", &SystemSnapshot::cached},
+    {"SwapTotal", &SystemSnapshot::swapTotal},
+    {"SwapFree", &SystemSnapshot::swapFree},
+};
+
+// Find the entry of table whose key is exactly [key, key + length)
+template <typename Member, std::size_t N>
+const Field<Member>* Lookup(const Field<Member> (&table)[N], const char* key,
+                            std::size_t length) {
+  for (const auto& field : table) {
+    if (std::strlen(field.key) == length &&
+        std::memcmp(field.key, key, length) == 0)
+      return &field;
+  }
+  return nullptr;
+}
+
+// Parse the cpu/cpuN line starting at p (past the "cpu" prefix)
+void ParseCpu(const char* p, LinuxParser::CpuTimes& times) {
+  char* end;
+  std::size_t slot = 0;
+  if (*p != ' ') {
+    slot = std::strtoul(p, &end, 10) + 1;
+    p = end;
+  }
+  if (slot >= times.Slots()) times.Resize(slot + 1);
+  // Older kernels report fewer states; the rest stay zero
+  for (auto& state : times.states) {
+    state[slot] = std::strtoull(p, &end, 10);
+    p = end;
+  }
+  times.present[slot] = 1;
+}
+}  // namespace
+
+// Read all global proc files; return false if any of them was unreadable
+bool SystemSnapshot::Read() {
+  bool stat = ReadStat();
+  bool meminfo = ReadMeminfo();
+  bool uptime = ReadUptime();
+  bool loadavg = ReadLoadavg();
+  return stat && meminfo && uptime && loadavg;
+}
+
+bool SystemSnapshot::ReadStat() {
+  std::fill(cpu.present.begin(), cpu.present.end(), 0);
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kStat, buffer_))
+    return false;
+  const char* p = buffer_.c_str();
+  while (*p != '\0') {
+    const char* eol = std::strchr(p, '\n');
+    if (eol == nullptr) eol = p + std::strlen(p);
+    const char* space = static_cast<const char*>(std::memchr(p, ' ', eol - p));
+    if (space != nullptr) {
+      if (std::strncmp(p, "cpu", 3) == 0) {
+        ParseCpu(p + 3, cpu);
+      } else if (auto field = Lookup(kStatFields, p, space - p)) {
+        // Only the first value matters (the total for "intr")
+        this->*field->member = std::strtoull(space, nullptr, 10);
+      }
+    }
+    p = *eol == '\0' ? eol : eol + 1;
+  }
+  return cpu.Slots() > 0 && cpu.present[0];
+}
+
+bool SystemSnapshot::ReadMeminfo() {
+  hasMemAvailable = false;
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kMeminfo,
+                                     buffer_))
+    return false;
+  const char* p = buffer_.c_str();
+  while (*p != '\0') {
+    const char* eol = std::strchr(p, '\n');
+    if (eol == nullptr) eol = p + std::strlen(p);
+    const char* colon = static_cast<const char*>(std::memchr(p, ':', eol - p));
+    if (colon != nullptr) {
+      if (auto field = Lookup(kMeminfoFields, p, colon - p)) {
+        this->*field->member = std::strtoull(colon + 1, nullptr, 10);
+        if (field->member == &SystemSnapshot::memAvailable)
+          hasMemAvailable = true;
+      }
+    }
+    p = *eol == '\0' ? eol : eol + 1;
+  }
+  return memTotal > 0;
+}
+
+bool SystemSnapshot::ReadUptime() {
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kUptime,
+                                     buffer_))
+    return false;
+  char* end;
+  uptime = std::strtod(buffer_.c_str(), &end);
+  idleTime = std::strtod(end, nullptr);
+  return true;
+}
+
+bool SystemSnapshot::ReadLoadavg() {
+  if (!ProcFileCache::Instance().Read(ProcFileCache::Global::kLoadavg,
+                                     buffer_))
+    return false;
+  char* end;
+  load1 = std::strtof(buffer_.c_str(), &end);
+  load5 = std::strtof(end, &end);
+  load15 = std::strtof(end, nullptr);
+  return true;
+}
+
+// Return the total jiffies of the aggregate CPU line. Guest time is already
+// accounted in user and nice, so it is not added.
+uint64_t SystemSnapshot::Jiffies() const {
+  if (cpu.Slots() == 0) return 0;
+  uint64_t total = 0;
+  for (std::size_t state = 0; state < LinuxParser::kGuest_; ++state) {
+    total += cpu.states[state][0];
+  }
+  return total;
+}
+
+// Return the fraction of memory in use, based on MemAvailable when the
+// kernel provides it
+float SystemSnapshot::MemoryUtilization() const {
+  if (memTotal == 0) return 0.0;
+  uint64_t unused =
+      hasMemAvailable ? memAvailable : memFree + buffers + cached;
+  unused = std::min(unused, memTotal);
+  return static_cast<float>(memTotal - unused) / static_cast<float>(memTotal);
+}
+
+// Return the fraction of swap in use
+float SystemSnapshot::SwapUtilization() const {
+  if (swapTotal == 0) return 0.0;
+  uint64_t used = swapTotal - std::min(swapFree, swapTotal);
+  return static_cast<float>(used) / static_cast<float>(swapTotal);
+}
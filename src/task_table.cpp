@@ -0,0 +1,99 @@
+#include "task_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "linux_parser.h"
+#include "proc_parser.h"
+
+TaskTable::TaskTable(int pid, uint64_t startTime)
+    : pid_(pid),
+      startTime_(startTime),
+      enumerator_(LinuxParser::ProcDirectory() + std::to_string(pid) +
+                  "/task") {}
+
+uint64_t TaskTable::StartTime() const { return startTime_; }
+
+const std::vector<TaskTable::Thread>& TaskTable::Threads() const {
+  return ranked_;
+}
+
+void TaskTable::Update(const Process& process, uint64_t totalDelta) {
+  bool listed = false;
+  if (listed_ != process.ThreadCount() || threads_.empty()) {
+    List();
+    listed_ = process.ThreadCount();
+    listed = true;
+  }
+
+  if (!listed && process.CpuUtilization() == 0.0f) {
+    // An idle process has no busy threads; their last jiffies still hold
+    for (auto& thread : threads_) thread.cpuUtilization = 0.0;
+  } else {
+    ProcParser::Stat stat;
+    for (std::size_t i = 0; i < threads_.size(); ++i) {
+      Thread& thread = threads_[i];
+      if (!ProcParser::ReadTaskStat(pid_, thread.tid, stat)) {
+        // Exited; another thread may have taken its place unnoticed
+        thread.state = 'X';
+        listed_ = -1;
+        continue;
+      }
+      uint64_t jiffies = stat.utime + stat.stime;
+      uint64_t used =
+          sampled_[i] && jiffies > jiffies_[i] ? jiffies - jiffies_[i] : 0;
+      thread.cpuUtilization =
+          totalDelta > 0
+              ? static_cast<float>(used) / static_cast<float>(totalDelta)
+              : 0.0f;
+      thread.state = stat.state;
+      std::size_t length = strnlen(stat.comm, sizeof(thread.name) - 1);
+      std::memcpy(thread.name, stat.comm, length);
+      thread.name[length] = '\0';
+      jiffies_[i] = jiffies;
+      sampled_[i] = true;
+    }
+  }
+
+  ranked_.clear();
+  for (const auto& thread : threads_) {
+    if (thread.state != 'X') ranked_.push_back(thread);
+  }
+  std::stable_sort(ranked_.begin(), ranked_.end(),
+                   [](const Thread& a, const Thread& b) {
+                     return a.cpuUtilization > b.cpuUtilization;
+                   });
+}
+
+// List the task directory again, keeping the samples of known threads
+void TaskTable::List() {
+  enumerator_.Read(tids_, true);
+  std::vector<Thread> threads;
+  std::vector<uint64_t> jiffies;
+  std::vector<uint8_t> sampled;
+  threads.reserve(tids_.size());
+  jiffies.reserve(tids_.size());
+  sampled.reserve(tids_.size());
+  // Both lists are sorted by tid
+  std::size_t old = 0;
+  for (int tid : tids_) {
+    while (old < threads_.size() && threads_[old].tid < tid) ++old;
+    if (old < threads_.size() && threads_[old].tid == tid &&
+        threads_[old].state != 'X') {
+      threads.push_back(threads_[old]);
+      jiffies.push_back(jiffies_[old]);
+      sampled.push_back(sampled_[old]);
+    } else {
+      Thread thread;
+      thread.pid = pid_;
+      thread.tid = tid;
+      threads.push_back(thread);
+      jiffies.push_back(0);
+      sampled.push_back(false);
+    }
+  }
+  threads_.swap(threads);
+  jiffies_.swap(jiffies);
+  sampled_.swap(sampled);
+}
@@ -0,0 +1,70 @@
+#include "user_table.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+// Don't stat the password file more often than this
+constexpr std::chrono::seconds kCheckInterval{1};
+
+UserTable::UserTable(std::string path) : path_(std::move(path)) {}
+
+// Return the username for uid, or an empty string if it is unknown
+std::string UserTable::Name(int uid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+  if (now - lastCheck_ >= kCheckInterval) {
+    lastCheck_ = now;
+    // The identity is only taken on once the file loaded, so a failed
+    // load is retried on the next check
+    struct stat st;
+    if (stat(path_.c_str(), &st) == 0 && Changed(st) && Reload()) {
+      device_ = st.st_dev;
+      inode_ = st.st_ino;
+      size_ = st.st_size;
+      mtime_ = st.st_mtim;
+    }
+  }
+  auto it = names_.find(uid);
+  return it != names_.end() ? it->second : std::string();
+}
+
+// Return true if st shows the password file was replaced or modified since
+// the last load
+bool UserTable::Changed(const struct stat& st) const {
+  return st.st_dev != device_ || st.st_ino != inode_ ||
+         st.st_size != size_ || st.st_mtim.tv_sec != mtime_.tv_sec ||
+         st.st_mtim.tv_nsec != mtime_.tv_nsec;
+}
+
+// Parse the whole password file (name:passwd:uid:...) in one pass; return
+// false if it can't be opened
+bool UserTable::Reload() {
+  std::ifstream filestream(path_);
+  if (!filestream.is_open()) return false;
+  std::unordered_map<int, std::string> names;
+  names.reserve(names_.size());
+  std::string line;
+  while (std::getline(filestream, line)) {
+    auto nameEnd = line.find(':');
+    if (nameEnd == std::string::npos) continue;
+    auto uidBegin = line.find(':', nameEnd + 1);
+    if (uidBegin == std::string::npos) continue;
+    int uid = 0;
+    bool digits = false;
+    for (auto i = uidBegin + 1; i < line.size() && line[i] != ':'; ++i) {
+      if (line[i] < '0' || line[i] > '9') {
+        digits = false;
+        break;
+      }
+      uid = uid * 10 + (line[i] - '0');
+      digits = true;
+    }
+    // The first entry wins, as with getpwuid()
+    if (digits) names.emplace(uid, line.substr(0, nameEnd));
+  }
+  names_ = std::move(names);
+  return true;
+}
@@ -0,0 +1,83 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+#include "instrument.h"
+
+WorkerPool::WorkerPool(std::size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t worker = 1; worker < threads; ++worker) {
+    threads_.emplace_back(&WorkerPool::Run, this, worker);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+// Return the number of workers, including the calling thread
+std::size_t WorkerPool::Size() const { return threads_.size() + 1; }
+
+// Run task over [0, count) split into chunks that workers claim from a
+// shared counter; return once every chunk has been processed
+void WorkerPool::ParallelFor(std::size_t count, std::size_t chunk,
+                             const Task& task) {
+  if (count == 0) return;
+  chunk = std::max<std::size_t>(chunk, 1);
+  if (threads_.empty() || count <= chunk) {
+    task(0, count, 0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    chunk_ = chunk;
+    next_.store(0, std::memory_order_relaxed);
+#if MONITOR_INSTRUMENT
+    phase_ = Instrument::Current();
+#endif
+    pending_ = threads_.size();
+    ++generation_;
+  }
+  start_.notify_all();
+  Work(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_ == 0; });
+  task_ = nullptr;
+}
+
+// Body of a pool thread: wait for a loop, help run it, repeat
+void WorkerPool::Run(std::size_t worker) {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+    {
+      INSTRUMENT_ADOPT(phase_);
+      Work(worker);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) done_.notify_one();
+  }
+}
+
+// Claim and process chunks until the range is exhausted
+void WorkerPool::Work(std::size_t worker) {
+  while (true) {
+    std::size_t begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+    if (begin >= count_) return;
+    (*task_)(begin, std::min(begin + chunk_, count_), worker);
+  }
+}